@@ -0,0 +1,198 @@
+/*
+ * Cost predicted load balancing, see cost_plan.h
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "cost_plan.h"
+
+typedef struct {
+    tile_t tile;
+    double cost;
+} planned_unit;
+
+/*
+ * Evaluates the samples of the preview, sample (i, j) is the point in column i * PLAN_STRIDE of row j * PLAN_STRIDE
+ * Returns the iterations of the samples row by row, or NULL if they could not be allocated
+ */
+static byte* render_preview(const grid_t* grid, const grid_coords_t* coords, span_kernel kernel, const grid_gen_params* params, const size_t columns, const size_t rows){
+    byte* samples = malloc(columns * rows);
+    CBASE* re = malloc(columns * sizeof(CBASE));
+    if(!samples || !re){
+        fprintf(stderr, "Error allocating a %zux%zu cost preview\n", columns, rows);
+        free(samples); free(re);
+        return NULL;
+    }
+    for(size_t i = 0; i < columns; i++){
+        re[i] = coords->re[i * PLAN_STRIDE];
+    }
+
+    // the preview does not count towards the stats of the grid, and its points are not in the iteration state
+    grid_gen_params preview_params = *params;
+    preview_params.stats = NULL;
+    preview_params.state = NULL;
+    const byte max_iterations = grid->max_iterations;
+
+    #pragma omp parallel for default(none) shared(samples, re, coords, kernel, preview_params, columns, rows, max_iterations) schedule(dynamic)
+    for(size_t j = 0; j < rows; j++){
+        kernel(samples + j * columns, re, coords->im[j * PLAN_STRIDE], columns, max_iterations, &preview_params);
+    }
+    free(re);
+    return samples;
+}
+
+/*
+ * Predicts the cost of a rectangle from the samples whose PLAN_STRIDE x PLAN_STRIDE cell overlaps it
+ */
+static double predict_cost(const byte* samples, const size_t columns, const tile_t rect){
+    const size_t i_start = rect.x / PLAN_STRIDE;
+    const size_t i_end = (rect.x + rect.width - 1) / PLAN_STRIDE;
+    const size_t j_start = rect.y / PLAN_STRIDE;
+    const size_t j_end = (rect.y + rect.height - 1) / PLAN_STRIDE;
+
+    double sum = 0;
+    for(size_t j = j_start; j <= j_end; j++){
+        for(size_t i = i_start; i <= i_end; i++){
+            sum += samples[j * columns + i] + PLAN_POINT_COST;
+        }
+    }
+    const double count = (i_end - i_start + 1) * (j_end - j_start + 1);
+    return sum / count * rect.width * rect.height;
+}
+
+static int by_descending_cost(const void* a, const void* b){
+    const double cost_a = ((const planned_unit*)a)->cost;
+    const double cost_b = ((const planned_unit*)b)->cost;
+    return (cost_a < cost_b) - (cost_a > cost_b);
+}
+
+/*
+ * Splits the tiles of a grid into strips of rows if they cost more than target, and merges tiles of a row of tiles while they cost less
+ * Returns the number of units stored in units, which needs room for a unit per row of the grid for every column of tiles
+ */
+static size_t partition_tiles(const grid_t* grid, const byte* samples, const size_t columns, const double target, planned_unit* units){
+    const size_t tiles = tile_count(grid);
+    size_t count = 0;
+    // the tiles merged so far in the current row of tiles
+    planned_unit merged = { .cost = 0 };
+    bool merging = false;
+
+    for(size_t i = 0; i < tiles; i++){
+        const tile_t tile = get_tile(grid, i);
+        const double cost = predict_cost(samples, columns, tile);
+
+        if(merging && (tile.x == 0 || merged.cost + cost > target)){
+            units[count++] = merged;
+            merging = false;
+        }
+
+        if(cost > target){
+            const size_t strips = fmin(tile.height, ceil(cost / target));
+            for(size_t s = 0; s < strips; s++){
+                tile_t strip = tile;
+                strip.y = tile.y + tile.height * s / strips;
+                strip.height = tile.y + tile.height * (s + 1) / strips - strip.y;
+                units[count++] = (planned_unit){ .tile = strip, .cost = predict_cost(samples, columns, strip) };
+            }
+        }
+        else if(merging){
+            merged.tile.width += tile.width;
+            merged.cost += cost;
+        }
+        else {
+            merged = (planned_unit){ .tile = tile, .cost = cost };
+            merging = true;
+        }
+    }
+    if(merging){
+        units[count++] = merged;
+    }
+    return count;
+}
+
+/*
+ * Plans the work units of a grid for a team of threads, the units are handed out by steal_tasks
+ * The units are dealt to the blocks steal_tasks starts each thread on from the most expensive down,
+ * so every thread starts on its most expensive unit and thieves take the cheapest ones
+ *
+ * Returns NULL if the plan could not be allocated
+ */
+cost_plan* create_cost_plan(const grid_t* grid, const grid_coords_t* coords, span_kernel kernel, const grid_gen_params* params, const int threads){
+    const size_t columns = (grid->x + PLAN_STRIDE - 1) / PLAN_STRIDE;
+    const size_t rows = (grid->y + PLAN_STRIDE - 1) / PLAN_STRIDE;
+    byte* samples = render_preview(grid, coords, kernel, params, columns, rows);
+    if(!samples) return NULL;
+
+    const size_t tile_columns = (grid->x + TILE_WIDTH - 1) / TILE_WIDTH;
+    planned_unit* units = malloc(tile_columns * grid->y * sizeof(planned_unit));
+    cost_plan* plan = malloc(sizeof(cost_plan));
+    if(!units || !plan){
+        fprintf(stderr, "Error allocating a cost plan\n");
+        free(samples); free(units); free(plan);
+        return NULL;
+    }
+
+    const tile_t whole = { .x = 0, .y = 0, .width = grid->x, .height = grid->y };
+    const double target = predict_cost(samples, columns, whole) / ((double)threads * PLAN_UNITS_PER_THREAD);
+    const size_t count = partition_tiles(grid, samples, columns, target, units);
+    free(samples);
+    qsort(units, count, sizeof(planned_unit), by_descending_cost);
+
+    *plan = (cost_plan){
+        .count = count,
+        .units = malloc(count * sizeof(tile_t)),
+        .predicted = malloc(count * sizeof(double)),
+        .seconds = calloc(count, sizeof(double))
+    };
+    size_t* next = malloc(threads * sizeof(size_t));
+    if(!plan->units || !plan->predicted || !plan->seconds || !next){
+        fprintf(stderr, "Error allocating a cost plan\n");
+        free(units); free(next);
+        free_cost_plan(plan);
+        return NULL;
+    }
+
+    // the block of thread t is [count * t / threads, count * (t + 1) / threads), see steal_tasks
+    for(int t = 0; t < threads; t++){
+        next[t] = count * t / threads;
+    }
+    int thread = 0;
+    for(size_t i = 0; i < count; i++){
+        while(next[thread] == count * (thread + 1) / threads){
+            thread = (thread + 1) % threads;
+        }
+        plan->units[next[thread]] = units[i].tile;
+        plan->predicted[next[thread]] = units[i].cost;
+        next[thread]++;
+        thread = (thread + 1) % threads;
+    }
+    free(units);
+    free(next);
+    return plan;
+}
+
+/*
+ * Writes the predicted and actual cost of every unit of a filled grid as csv
+ * The actual cost is counted like the prediction, from the iterations of the points of the unit plus PLAN_POINT_COST for each point
+ */
+void write_cost_map(FILE* file, const grid_t* grid, const cost_plan* plan){
+    fprintf(file, "x,y,width,height,predicted,actual,seconds\n");
+    for(size_t i = 0; i < plan->count; i++){
+        const tile_t unit = plan->units[i];
+        double actual = 0;
+        for(size_t y = unit.y; y < unit.y + unit.height; y++){
+            for(size_t x = unit.x; x < unit.x + unit.width; x++){
+                actual += grid->data[y * grid->x + x] + PLAN_POINT_COST;
+            }
+        }
+        fprintf(file, "%zu,%zu,%zu,%zu,%.0f,%.0f,%.9f\n", unit.x, unit.y, unit.width, unit.height, plan->predicted[i], actual, plan->seconds[i]);
+    }
+}
+
+void free_cost_plan(cost_plan* plan){
+    if(!plan) return;
+    free(plan->units);
+    free(plan->predicted);
+    free(plan->seconds);
+    free(plan);
+}
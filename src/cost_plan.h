@@ -0,0 +1,42 @@
+/*
+ * Cost predicted load balancing for the tiles of shared-fractals, see GEN_COST_PLAN
+ *
+ * A preview evaluates every PLAN_STRIDE-th point of every PLAN_STRIDE-th row with the kernel of the grid.
+ * The iterations of the samples that fall in a tile, plus PLAN_POINT_COST for the work every point costs outside its iterations,
+ * predict the cost of the tile. Tiles are then split into strips of rows or merged with their neighbours into work units
+ * of about equal cost, PLAN_UNITS_PER_THREAD for every thread, and the units are dealt to the threads from the most expensive down
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include "fractals.h"
+#include "grids.h"
+#include "traversal.h"
+
+// the distance in points between the samples of the preview
+#ifndef PLAN_STRIDE
+#define PLAN_STRIDE 8
+#endif
+
+// the cost of a point that is not spent in its iterations, in iterations
+#ifndef PLAN_POINT_COST
+#define PLAN_POINT_COST 4
+#endif
+
+#ifndef PLAN_UNITS_PER_THREAD
+#define PLAN_UNITS_PER_THREAD 16
+#endif
+
+typedef struct {
+    size_t count;
+    // the units in the order they are handed to steal_tasks
+    tile_t* units;
+    // the predicted cost of each unit in iterations, and the time it took to fill once the grid is filled
+    double* predicted;
+    double* seconds;
+} cost_plan;
+
+cost_plan* create_cost_plan(const grid_t* grid, const grid_coords_t* coords, span_kernel kernel, const grid_gen_params* params, const int threads);
+void write_cost_map(FILE* file, const grid_t* grid, const cost_plan* plan);
+void free_cost_plan(cost_plan* plan);
@@ -0,0 +1,141 @@
+/*
+ * Runtime selection of the row kernels based on the features of the running cpu
+ */
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "cpu_dispatch.h"
+
+const simd_kernels_t* row_kernels = &simd_kernels_sse2;
+// the float kernels for the instruction set of row_kernels
+static const simd_kernels_t* float_row_kernels = &float_kernels_sse2;
+
+/*
+ * Checks if the running cpu (and operating system) can execute a set of kernels
+ */
+static bool isa_supported(const simd_kernels_t* kernels){
+    __builtin_cpu_init();
+    if(kernels == &simd_kernels_avx512){
+        return __builtin_cpu_supports("avx512f");
+    }
+    if(kernels == &simd_kernels_avx2){
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+    return __builtin_cpu_supports("sse2");
+}
+
+/*
+ * Selects the kernels used by the fractal generators
+ * If isa is NULL or "auto" the kernels with the widest vectors the cpu supports are selected,
+ * otherwise the kernels for the named instruction set are selected
+ *
+ * Returns false if isa is not a known instruction set or is not supported by the cpu
+ */
+bool select_kernels(const char* isa){
+    const simd_kernels_t* available[] = { &simd_kernels_avx512, &simd_kernels_avx2, &simd_kernels_sse2 };
+    const simd_kernels_t* available_float[] = { &float_kernels_avx512, &float_kernels_avx2, &float_kernels_sse2 };
+    const size_t count = sizeof(available) / sizeof(available[0]);
+    const bool automatic = !isa || strcmp(isa, "auto") == 0;
+
+    for(size_t i = 0; i < count; i++){
+        if(!automatic && strcmp(isa, available[i]->isa) != 0) continue;
+
+        if(!isa_supported(available[i])){
+            if(automatic) continue;
+            fprintf(stderr, "Instruction set %s is not supported by this cpu\n", isa);
+            return false;
+        }
+        row_kernels = available[i];
+        float_row_kernels = available_float[i];
+        return true;
+    }
+
+    if(!automatic){
+        fprintf(stderr, "Unknown instruction set: %s, supported instruction sets: auto, avx512, avx2, sse2\n", isa);
+    }
+    return false;
+}
+
+/*
+ * Gets the kernel for a multibrot set of a given degree, or a multicorn set if conjugate is set
+ * Integer degrees from 2 to INTEGER_DEGREE_LIMIT have kernels specialized for that degree, other degrees use cpow
+ */
+span_kernel power_kernel(const double degree, const bool conjugate){
+    if(degree >= 2 && degree <= INTEGER_DEGREE_LIMIT && degree == (int)degree){
+        const int index = degree;
+        return conjugate ? row_kernels->multicorn_integer_rows[index] : row_kernels->multibrot_integer_rows[index];
+    }
+    return conjugate ? row_kernels->multicorn_row : row_kernels->multibrot_row;
+}
+
+/*
+ * Finds the kernel that takes the place of kernel from one table in another table
+ * Returns NULL if the other table does not have that kernel
+ */
+static span_kernel matching_kernel(const simd_kernels_t* from, const simd_kernels_t* to, const span_kernel kernel){
+    // the kernels are the members of a table from mandelbrot_row to its end
+    const span_kernel* from_kernels = &from->mandelbrot_row;
+    const span_kernel* to_kernels = &to->mandelbrot_row;
+    const size_t count = (sizeof(simd_kernels_t) - offsetof(simd_kernels_t, mandelbrot_row)) / sizeof(span_kernel);
+    for(size_t i = 0; i < count; i++){
+        if(from_kernels[i] == kernel) return to_kernels[i];
+    }
+    return NULL;
+}
+
+/*
+ * Gets the mantissa bits needed to resolve the step between the points of a grid with PRECISION_GUARD_BITS to spare
+ * The rounding error grows with the largest coordinate, which is at least the escape radius of 2 that the orbits reach,
+ * and with every iteration, which costs up to log2(max_iterations) more bits
+ * This is a heuristic, chaotic orbits near the boundary of the set amplify the rounding error far faster than that,
+ * so a grid iterated in narrower kernels than the build's is approximate
+ */
+static int needed_precision_bits(const grid_t* grid){
+    const double step_re = fabs((double)(grid->upper_right.re - grid->lower_left.re)) / grid->x;
+    const double step_im = fabs((double)(grid->upper_right.im - grid->lower_left.im)) / grid->y;
+    const double step = fmin(step_re, step_im);
+    if(!(step > 0)) return INT_MAX;
+
+    double magnitude = 2;
+    magnitude = fmax(magnitude, fabs((double)grid->lower_left.re));
+    magnitude = fmax(magnitude, fabs((double)grid->lower_left.im));
+    magnitude = fmax(magnitude, fabs((double)grid->upper_right.re));
+    magnitude = fmax(magnitude, fabs((double)grid->upper_right.im));
+    return 1 + PRECISION_GUARD_BITS + (int)ceil(log2(magnitude / step) + log2(fmax(grid->max_iterations, 1)));
+}
+
+/*
+ * Swaps a kernel of row_kernels for the same kernel with the cheapest arithmetic that can resolve the points of a grid, see GEN_AUTO_PRECISION
+ * The float kernels are tried first, then row_kernels, then the long double kernels if they are wider than row_kernels.
+ * If none of them is wide enough the widest is used and a warning is printed
+ *
+ * offsets is set if the chosen kernel takes its coordinates as offsets, see create_grid_coords
+ */
+span_kernel precision_kernel(const grid_t* grid, const grid_gen_params* params, const span_kernel kernel, bool* offsets){
+    const simd_kernels_t* tables[] = { float_row_kernels, row_kernels, &extended_kernels };
+    const size_t count = extended_kernels.precision_bits > row_kernels->precision_bits ? 3 : 2;
+    const int needed = needed_precision_bits(grid);
+
+    // row_kernels always has the kernel, so one is chosen
+    const simd_kernels_t* chosen = NULL;
+    span_kernel chosen_kernel = NULL;
+    for(size_t i = 0; i < count; i++){
+        const span_kernel candidate = matching_kernel(row_kernels, tables[i], kernel);
+        if(!candidate) continue;
+
+        chosen = tables[i];
+        chosen_kernel = candidate;
+        if(chosen->precision_bits >= needed) break;
+    }
+
+    if(chosen->precision_bits < needed){
+        fprintf(stderr, "Warning: the points are closer than %s kernels can resolve, the grid will be inaccurate\n", chosen->precision);
+    }
+    if(params->stats){
+        params->stats->precision = chosen->precision;
+    }
+    *offsets = chosen->offset_coordinates;
+    return chosen_kernel;
+}
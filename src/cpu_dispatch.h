@@ -0,0 +1,17 @@
+/*
+ * Selects which instruction set the row kernels run with
+ *
+ * The kernels are built for several instruction sets so a single binary can run on any x86-64 cpu,
+ * while still using the widest vectors the cpu supports
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "simd_kernels.h"
+
+// the kernels selected by select_kernels, defaults to the baseline instruction set
+extern const simd_kernels_t* row_kernels;
+
+bool select_kernels(const char* isa);
+span_kernel power_kernel(const double degree, const bool conjugate);
+span_kernel precision_kernel(const grid_t* grid, const grid_gen_params* params, const span_kernel kernel, bool* offsets);
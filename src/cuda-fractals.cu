@@ -4,6 +4,7 @@
 #include <cuda_runtime.h>
 #include <thrust/complex.h>
 #include "fractals.h"
+#include "fixed_point.h"
 #include "grids.h"
 
 /*
@@ -345,4 +346,29 @@ void julia_grid(grid_t* grid, const grid_gen_params* params){
     CHECK(cudaFree(d_grid_data));
     CHECK(cudaDeviceReset());
 }
+
+/*
+ * The fixed point kernels rely on 128 bit integers, which the device does not have, so they run on the host
+ */
+static void fixed_point_traverse(grid_t* grid, const grid_gen_params* params, const enum fixed_point_map map){
+    fixed_point_state* state = create_fixed_point_state(grid, params, map);
+    if(!state) return;
+
+    for(size_t row = 0; row < grid->y; row++){
+        fixed_point_row(state, row);
+    }
+    free_fixed_point_state(state);
+}
+
+void mandelbrot_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_MANDELBROT);
+}
+
+void tricorn_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_TRICORN);
+}
+
+void burning_ship_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_BURNING_SHIP);
+}
 }
@@ -0,0 +1,65 @@
+/*
+ * Double-double arithmetic, a number is the unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2
+ *
+ * The sums and products are built from error free transformations, which give the rounding error of a double operation
+ * exactly as another double, for a total of about 106 bits of mantissa. They rely on every operation being rounded on its own,
+ * so the code using them must not be compiled with floating point contraction (-ffp-contract=off) or -ffast-math
+ */
+#pragma once
+
+typedef struct {
+    double hi;
+    double lo;
+} double_double;
+
+/*
+ * a + b = s + err exactly, for any a and b
+ */
+static inline double_double two_sum(const double a, const double b){
+    const double s = a + b;
+    const double b_virtual = s - a;
+    const double err = (a - (s - b_virtual)) + (b - b_virtual);
+    return (double_double){ s, err };
+}
+
+/*
+ * a + b = s + err exactly, if |a| >= |b|
+ */
+static inline double_double quick_two_sum(const double a, const double b){
+    const double s = a + b;
+    return (double_double){ s, b - (s - a) };
+}
+
+/*
+ * a * b = p + err exactly, by splitting each factor into halves of 26 bits whose products are exact (Dekker)
+ */
+static inline double_double two_prod(const double a, const double b){
+    const double p = a * b;
+    const double a_split = 134217729.0 * a;
+    const double a_hi = a_split - (a_split - a);
+    const double a_lo = a - a_hi;
+    const double b_split = 134217729.0 * b;
+    const double b_hi = b_split - (b_split - b);
+    const double b_lo = b - b_hi;
+    return (double_double){ p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo };
+}
+
+static inline double_double dd_add(const double_double a, const double_double b){
+    const double_double s = two_sum(a.hi, b.hi);
+    const double_double t = two_sum(a.lo, b.lo);
+    double_double result = quick_two_sum(s.hi, s.lo + t.hi);
+    return quick_two_sum(result.hi, result.lo + t.lo);
+}
+
+static inline double_double dd_neg(const double_double a){
+    return (double_double){ -a.hi, -a.lo };
+}
+
+static inline double_double dd_sub(const double_double a, const double_double b){
+    return dd_add(a, dd_neg(b));
+}
+
+static inline double_double dd_mul_double(const double_double a, const double b){
+    const double_double p = two_prod(a.hi, b);
+    return quick_two_sum(p.hi, p.lo + a.lo * b);
+}
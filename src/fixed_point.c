@@ -0,0 +1,192 @@
+/*
+ * Fixed point escape time kernels, see fixed_point.h
+ *
+ * The 64 bit format multiplies through __int128, the 128 bit format builds the 256 bit product out of 64 bit halves.
+ * Products are truncated, which only moves points by an error FIXED_GUARD_BITS below their spacing
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "fixed_point.h"
+#include "high_precision.h"
+
+typedef __int128 fixed128;
+typedef unsigned __int128 ufixed128;
+
+struct fixed_point_state {
+    grid_t* grid;
+    enum fixed_point_map map;
+    // 64 or 128
+    int bits;
+    // the lower left point of the view and the step between points, in the chosen format
+    fixed128 origin_re;
+    fixed128 origin_im;
+    fixed128 step_re;
+    fixed128 step_im;
+};
+
+/*
+ * Converts a high precision number to a fixed point number with fraction_bits bits of fraction, rounding towards -infinity
+ */
+static fixed128 hp_to_fixed(const hp_real a, const int fraction_bits){
+    // the top 128 bits of the fraction of a
+    const ufixed128 fraction = (ufixed128)a.limb[HP_LIMBS - 2] << 64 | (HP_LIMBS >= 3 ? a.limb[HP_LIMBS - 3] : 0);
+    const fixed128 integer = (int64_t)a.limb[HP_LIMBS - 1];
+    return (fixed128)((ufixed128)integer << fraction_bits | fraction >> (128 - fraction_bits));
+}
+
+static inline int64_t fixed64_mul(const int64_t a, const int64_t b){
+    return (int64_t)(((fixed128)a * b) >> FIXED64_FRACTION_BITS);
+}
+
+/*
+ * Multiplies two 128 bit fixed point numbers whose magnitudes are below 2^(FIXED_INTEGER_BITS - 1)
+ */
+static inline fixed128 fixed128_mul(const fixed128 a, const fixed128 b){
+    const bool negative = (a < 0) != (b < 0);
+    const ufixed128 abs_a = a < 0 ? -(ufixed128)a : (ufixed128)a;
+    const ufixed128 abs_b = b < 0 ? -(ufixed128)b : (ufixed128)b;
+    const uint64_t a_lo = abs_a, a_hi = abs_a >> 64;
+    const uint64_t b_lo = abs_b, b_hi = abs_b >> 64;
+
+    const ufixed128 lo_lo = (ufixed128)a_lo * b_lo;
+    const ufixed128 lo_hi = (ufixed128)a_lo * b_hi;
+    const ufixed128 hi_lo = (ufixed128)a_hi * b_lo;
+    const ufixed128 hi_hi = (ufixed128)a_hi * b_hi;
+
+    // the 256 bit product is high * 2^128 + low
+    const ufixed128 middle = (lo_lo >> 64) + (uint64_t)lo_hi + (uint64_t)hi_lo;
+    const ufixed128 low = middle << 64 | (uint64_t)lo_lo;
+    const ufixed128 high = hi_hi + (lo_hi >> 64) + (hi_lo >> 64) + (middle >> 64);
+    const ufixed128 product = high << (128 - FIXED128_FRACTION_BITS) | low >> FIXED128_FRACTION_BITS;
+    return negative ? -(fixed128)product : (fixed128)product;
+}
+
+/*
+ * Iterates a point the same way as the scalar kernels, |z| <= 2 is tested through its components first so the squares can not overflow
+ * FIXED_TYPE, FIXED_MUL and FRACTION_BITS select the format
+ */
+#define FIXED_ESCAPE(FIXED_TYPE, FIXED_MUL, FRACTION_BITS) \
+    const FIXED_TYPE two = (FIXED_TYPE)2 << (FRACTION_BITS); \
+    const FIXED_TYPE four = (FIXED_TYPE)4 << (FRACTION_BITS); \
+    FIXED_TYPE x = c_re; \
+    FIXED_TYPE y = c_im; \
+    byte iteration = 0; \
+    while(iteration < max_iterations){ \
+        if(x > two || x < -two || y > two || y < -two) break; \
+        const FIXED_TYPE xx = FIXED_MUL(x, x); \
+        const FIXED_TYPE yy = FIXED_MUL(y, y); \
+        if(xx + yy > four) break; \
+        \
+        FIXED_TYPE xy; \
+        switch(map){ \
+            case FIXED_TRICORN: \
+                xy = FIXED_MUL(x, y); \
+                y = c_im - (xy + xy); \
+                break; \
+            case FIXED_BURNING_SHIP: \
+                xy = FIXED_MUL(x < 0 ? -x : x, y < 0 ? -y : y); \
+                y = xy + xy + c_im; \
+                break; \
+            default: \
+                xy = FIXED_MUL(x, y); \
+                y = xy + xy + c_im; \
+                break; \
+        } \
+        x = xx - yy + c_re; \
+        iteration++; \
+    } \
+    return iteration;
+
+static byte fixed64_escape(const int64_t c_re, const int64_t c_im, const enum fixed_point_map map, const byte max_iterations){
+    FIXED_ESCAPE(int64_t, fixed64_mul, FIXED64_FRACTION_BITS)
+}
+
+static byte fixed128_escape(const fixed128 c_re, const fixed128 c_im, const enum fixed_point_map map, const byte max_iterations){
+    FIXED_ESCAPE(fixed128, fixed128_mul, FIXED128_FRACTION_BITS)
+}
+
+/*
+ * Creates the state of a fixed point render of a grid, using the view in params if there is one and the corners of the grid otherwise
+ * The 64 bit format is chosen if the step between points is at least 2^FIXED_GUARD_BITS of its resolution, otherwise the 128 bit format is
+ *
+ * Returns NULL if the view does not fit in the fixed point formats
+ */
+fixed_point_state* create_fixed_point_state(grid_t* grid, const grid_gen_params* params, const enum fixed_point_map map){
+    hp_real origin_re, origin_im;
+    double step_re, step_im;
+    if(params->view){
+        origin_re = hp_add(params->view->center_re, hp_from_double(params->view->lower_left_offset.re));
+        origin_im = hp_add(params->view->center_im, hp_from_double(params->view->lower_left_offset.im));
+        step_re = (params->view->upper_right_offset.re - params->view->lower_left_offset.re) / (double)grid->x;
+        step_im = (params->view->upper_right_offset.im - params->view->lower_left_offset.im) / (double)grid->y;
+    }
+    else {
+        origin_re = complex_to_hp_re(grid->lower_left);
+        origin_im = complex_to_hp_im(grid->lower_left);
+        step_re = hp_to_double(hp_sub(complex_to_hp_re(grid->upper_right), origin_re)) / (double)grid->x;
+        step_im = hp_to_double(hp_sub(complex_to_hp_im(grid->upper_right), origin_im)) / (double)grid->y;
+    }
+
+    // the corners of the view have to stay within 4 so an iteration of a point with |z| <= 2 does not overflow
+    const double limit = 1 << (FIXED_INTEGER_BITS - 3);
+    const double re = hp_to_double(origin_re);
+    const double im = hp_to_double(origin_im);
+    if(re <= -limit || im <= -limit || re + step_re * grid->x >= limit || im + step_im * grid->y >= limit){
+        fprintf(stderr, "The view does not fit in the fixed point kernels, its corners have to lie within %g of 0\n", limit);
+        return NULL;
+    }
+
+    fixed_point_state* state = malloc(sizeof(fixed_point_state));
+    if(!state){
+        fprintf(stderr, "Error allocating fixed point state\n");
+        return NULL;
+    }
+
+    const double smallest_step = fmin(fabs(step_re), fabs(step_im));
+    const int bits = smallest_step >= ldexp(1, FIXED_GUARD_BITS - FIXED64_FRACTION_BITS) ? 64 : 128;
+    const int fraction_bits = bits == 64 ? FIXED64_FRACTION_BITS : FIXED128_FRACTION_BITS;
+    if(bits == 128 && smallest_step < ldexp(1, FIXED_GUARD_BITS - FIXED128_FRACTION_BITS)){
+        fprintf(stderr, "Warning: the points are closer than the 128 bit fixed point kernels can resolve, the grid will be inaccurate\n");
+    }
+
+    *state = (fixed_point_state){
+        .grid = grid,
+        .map = map,
+        .bits = bits,
+        .origin_re = hp_to_fixed(origin_re, fraction_bits),
+        .origin_im = hp_to_fixed(origin_im, fraction_bits),
+        .step_re = hp_to_fixed(hp_from_double(step_re), fraction_bits),
+        .step_im = hp_to_fixed(hp_from_double(step_im), fraction_bits)
+    };
+    if(params->stats){
+        params->stats->fixed_point_bits = bits;
+    }
+    return state;
+}
+
+/*
+ * Fills a row of the grid, rows can be filled in parallel
+ */
+void fixed_point_row(const fixed_point_state* state, const size_t row){
+    grid_t* grid = state->grid;
+    byte* out = grid->data + row * grid->x;
+    const fixed128 c_im = state->origin_im + (fixed128)row * state->step_im;
+
+    if(state->bits == 64){
+        for(size_t column = 0; column < grid->x; column++){
+            const fixed128 c_re = state->origin_re + (fixed128)column * state->step_re;
+            out[column] = fixed64_escape(c_re, c_im, state->map, grid->max_iterations);
+        }
+    }
+    else {
+        for(size_t column = 0; column < grid->x; column++){
+            const fixed128 c_re = state->origin_re + (fixed128)column * state->step_re;
+            out[column] = fixed128_escape(c_re, c_im, state->map, grid->max_iterations);
+        }
+    }
+}
+
+void free_fixed_point_state(fixed_point_state* state){
+    free(state);
+}
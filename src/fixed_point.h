@@ -0,0 +1,45 @@
+/*
+ * Fixed point escape time kernels for zooms past the precision of a double, where the points of a view only need
+ * a fixed number of fraction bits because they all lie within a few units of 0
+ *
+ * Numbers are two's complement integers with FIXED_INTEGER_BITS bits for the sign and integer part, the rest is fraction.
+ * The 64 bit format is used while the step between points is at least FIXED_GUARD_BITS above its resolution,
+ * otherwise the 128 bit format is used, see create_fixed_point_state
+ *
+ * The traversal of the rows is left to the backends, see fixed_point_traverse in serial-fractals.c and shared-fractals.c,
+ * cuda-fractals runs them on the host
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "fractals.h"
+#include "grids.h"
+
+// the bits of a fixed point number that hold its sign and integer part, enough for |z| <= 2 and the corners of a view within 4
+#define FIXED_INTEGER_BITS 5
+#define FIXED64_FRACTION_BITS (64 - FIXED_INTEGER_BITS)
+#define FIXED128_FRACTION_BITS (128 - FIXED_INTEGER_BITS)
+
+// the fraction bits kept below the step between two points, which absorb the rounding of the iterations
+#ifndef FIXED_GUARD_BITS
+#define FIXED_GUARD_BITS 16
+#endif
+
+enum fixed_point_map {
+    FIXED_MANDELBROT,
+    FIXED_TRICORN,
+    FIXED_BURNING_SHIP
+};
+
+typedef struct fixed_point_state fixed_point_state;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+fixed_point_state* create_fixed_point_state(grid_t* grid, const grid_gen_params* params, const enum fixed_point_map map);
+void fixed_point_row(const fixed_point_state* state, const size_t row);
+void free_fixed_point_state(fixed_point_state* state);
+#ifdef __cplusplus
+}
+#endif
@@ -8,11 +8,11 @@
 #include "precision.h"
 #include "fractal_render.h"
 #include "renderers.h"
-
-#define BUFFER_SIZE 32
+#include "plotting.h"
+#include "png_writer.h"
 
 void print_usage(FILE* file, const char* program_name) {
-    fprintf(file, "Usage: %s -i input.grid [-r renderer] [-o output.ext]\n", program_name);
+    fprintf(file, "Usage: %s -i input.grid [-r renderer] [-c x,y,width,height] [-o output.ext]\n", program_name);
 }
 
 void print_help(){
@@ -21,6 +21,14 @@ void print_help(){
            "  -r, --renderer <renderer>       the renderer to use, defaults to the text renderer\n"
            "      renderers:   txt, png, gif (TODO, with additional features)\n"
            "  -d, --delay <delay>             the delay between animation frames in 1/100 s\n"
+           "  -z, --compression <level>       the compression level of png images from 0 (fastest, largest) to 9 (slowest, smallest),\n"
+           "                                  defaults to the zlib default of 6\n"
+           "  -g, --gradient <gradient>       the gradient the grid is colored with, defaults to green for png and inverse for gif\n"
+           "      gradients:   green, inverse, fire (linear), cyclic, equalized (histogram-equalized green)\n"
+           "  -H, --histogram <histogram>     the histogram of the grid written by fractals --histogram, saves counting the grid\n"
+           "                                  for -g equalized\n"
+           "  -c, --crop <x>,<y>,<w>,<h>      only render the w by h region starting at point (x, y) of the grid,\n"
+           "                                  for chunked grids only the chunks covering the region are read\n"
            "  -o, --output <output file>      the file to output the result of rendering, if not given defaults to fractal.out\n"
            "  -v, --verbose                   verbose output\n"
            "  -h, --help                      prints this help and exits\n"
@@ -43,20 +51,42 @@ void error_exit(const char* message, const char* issue) {
 }
 
 /*
- * Cleanup io files and a grid
+ * Cleanup io files and a grid, mapped grids are unmapped instead of freed
  */
-void cleanup(FILE* output_file, FILE* input_file, grid_t* grid) {
+void cleanup(FILE* output_file, FILE* input_file, grid_t* grid, const bool mapped) {
     if(output_file) fclose(output_file);
     // closing stdin is not recommended, can supposedly cause odd behvaior
     if(input_file && input_file != stdin) fclose(input_file);
-    if(grid) free_grid(grid);
+    if(grid){
+        if(mapped){
+            unmap_grid(grid);
+        }
+        else {
+            free_grid(grid);
+        }
+    }
+}
+
+/*
+ * Reads a grid from an opened .grid file, flat grids are memory mapped instead of read
+ * mapped is set if the grid has to be released with unmap_grid, the file can be closed once the grid is read
+ */
+grid_t* load_grid(FILE* file, const char* filename, bool* mapped){
+    *mapped = false;
+    if(grid_file_version(file) != GRID_VERSION_FLAT){
+        return read_grid(file);
+    }
+    grid_t* grid = map_grid(filename);
+    *mapped = grid != NULL;
+    return grid;
 }
 
 /*
  * Wrapper for print_grid to meet renderer type
  */
-void render_txt(FILE* output, const renderer_params* params){
+int render_txt(FILE* output, const renderer_params* params){
     print_grid(output, params->grid);
+    return 0;
 }
 
 
@@ -67,14 +97,24 @@ int main(const int argc, char* argv[]){
     char* output_filename = "fractal.txt";
     renderer_func renderer = render_txt;
     int anim_delay = 30;
+    int compression_level = PNG_DEFAULT_LEVEL;
+    gradient map = GRADIENT_DEFAULT;
+    char* histogram_filename = NULL;
+    size_t histogram[256];
     bool multigrid = false;
     bool verbose = false;
+    bool crop = false;
+    size_t crop_x = 0, crop_y = 0, crop_width = 0, crop_height = 0;
     renderer_params* params = malloc(sizeof(renderer_params));
 
     static struct option long_options[] = {
         {"input", required_argument, NULL, 'i'},
         {"renderer", required_argument, NULL, 'r'},
         {"delay", required_argument, NULL, 'd'},
+        {"crop", required_argument, NULL, 'c'},
+        {"compression", required_argument, NULL, 'z'},
+        {"gradient", required_argument, NULL, 'g'},
+        {"histogram", required_argument, NULL, 'H'},
         {"output", required_argument, NULL, 'o'},
         {"verbose", no_argument, NULL, 'v'},
         {"help", no_argument, NULL, 'h'},
@@ -82,7 +122,7 @@ int main(const int argc, char* argv[]){
     };
 
     int opt;
-    while((opt = getopt_long(argc, argv, "i:r:o:d:vh", long_options, NULL)) != -1){
+    while((opt = getopt_long(argc, argv, "i:r:o:d:c:z:g:H:vh", long_options, NULL)) != -1){
         switch(opt){
             case 'i':
                 input_filename = optarg;
@@ -113,6 +153,30 @@ int main(const int argc, char* argv[]){
                     exit(2);
                 }
                 break;
+            case 'c':
+                if(sscanf(optarg, "%zu,%zu,%zu,%zu", &crop_x, &crop_y, &crop_width, &crop_height) != 4){
+                    fprintf(stderr, "Failed to parse crop region: %s", optarg);
+                    exit(2);
+                }
+                crop = true;
+                break;
+            case 'z':
+                compression_level = strtol(optarg, NULL, 10);
+                if(compression_level < 0 || compression_level > 9){
+                    fprintf(stderr, "Invalid compression level: %s", optarg);
+                    exit(2);
+                }
+                break;
+            case 'g':
+                map = parse_gradient(optarg);
+                if(map < 0){
+                    fprintf(stderr, "Unrecognized gradient: %s", optarg);
+                    exit(2);
+                }
+                break;
+            case 'H':
+                histogram_filename = optarg;
+                break;
             case 'v':
                 verbose = true;
                 break;
@@ -133,9 +197,11 @@ int main(const int argc, char* argv[]){
     FILE* input_file = NULL;
     FILE* output_file = NULL;
     grid_t* grid = NULL;
+    // flat grids read from files are memory mapped, see load_grid
+    volatile bool mapped = false;
 
     if (setjmp(error_buffer) != 0) {
-        cleanup(output_file, input_file, grid);
+        cleanup(output_file, input_file, grid, mapped);
         exit(EXIT_FAILURE);
     }
 
@@ -155,35 +221,40 @@ int main(const int argc, char* argv[]){
         else {
             input_file = fopen(input_filename, "rb");
             if(!input_file) { error_exit("Error opening input file", input_filename); }
-            grid = read_grid(input_file);
+            if(crop){
+                grid = read_grid_region(input_file, crop_x, crop_y, crop_width, crop_height);
+            }
+            else {
+                bool grid_mapped;
+                grid = load_grid(input_file, input_filename, &grid_mapped);
+                mapped = grid_mapped;
+            }
             if(!grid) { error_exit("Error reading from file", input_filename); }
         }
         params->grid = grid;
+        params->histogram = NULL;
+        if(histogram_filename){
+            FILE* histogram_file = fopen(histogram_filename, "rb");
+            if(!histogram_file) { error_exit("Error opening histogram file", histogram_filename); }
+            const bool read = read_histogram(histogram_file, grid, histogram);
+            fclose(histogram_file);
+            if(!read) { error_exit("Error reading histogram", histogram_filename); }
+            params->histogram = histogram;
+        }
     }
     else {
-        grid_t** grids = malloc(BUFFER_SIZE * sizeof(grid_t*));
-        char filename[256];
-        size_t size = 0;
-        FILE* file;
+        // the frames are read from the list one at a time while the animation is rendered, see render_gif
         if(strcmp(input_filename, "-") == 0){
-            file = stdin;
+            params->animation.frames = stdin;
         }
         else {
-            file = fopen(input_filename, "r");
-        }
-        while(fgets(filename, sizeof(filename), file) != NULL && size < BUFFER_SIZE){
-            //remove trailing newline from fgets
-            filename[strcspn(filename, "\n")] = 0;
-            input_file = fopen(filename, "rb");
-            if (!input_file) { error_exit("Error opening input file", filename); }
-            grids[size] = read_grid(input_file);
-            if (!grids[size]) { error_exit("Error reading from file", filename); }
-            size++;
+            input_file = fopen(input_filename, "r");
+            if(!input_file) { error_exit("Error opening frame list", input_filename); }
+            params->animation.frames = input_file;
         }
-        //TODO: check grids to make sure they are have the same dimensions
-        params->grid_array.delay = anim_delay;
-        params->grid_array.size = size;
-        params->grid_array.grids = grids;
+        params->animation.delay = anim_delay;
+        // the frames are counted one by one
+        params->histogram = NULL;
     }
 
 
@@ -191,9 +262,14 @@ int main(const int argc, char* argv[]){
         print_grid_info(grid);
     }
 
-    renderer(output_file, params);
+    params->compression_level = compression_level;
+    params->gradient = map;
+    if(renderer(output_file, params) == RENDER_ERROR){
+        free(params);
+        error_exit("Error rendering to", output_filename);
+    }
 
-    cleanup(output_file, input_file, grid);
+    cleanup(output_file, input_file, grid, mapped);
     free(params);
     return 0;
 }
@@ -1,17 +1,32 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <gd.h>
 
 #include "grids.h"
+#include "plotting.h"
 
-typedef union {
-    grid_t* grid;
-    struct {
-        size_t size;
-        int delay;
-        grid_t** grids;
-    } grid_array;
+typedef struct {
+    union {
+        grid_t* grid;
+        struct {
+            // the list of the grid files of the frames, one per line
+            FILE* frames;
+            int delay;
+        } animation;
+    };
+    // the zlib level of png renders from 0 to 9, or PNG_DEFAULT_LEVEL, see write_png
+    int compression_level;
+    // the gradient the grids are colored with, or GRADIENT_DEFAULT for the default of the renderer
+    gradient gradient;
+    // the histogram of the grid written by the generator, or NULL if the renderer has to count it, see grid_histogram
+    const size_t* histogram;
 } renderer_params;
-typedef void (*renderer_func)(FILE*, const renderer_params*);
-typedef gdImagePtr (*grid_image_converter)(grid_t*);
+
+// renderer errors
+#define RENDER_ERROR 1
+
+typedef int (*renderer_func)(FILE*, const renderer_params*);
+
+grid_t* load_grid(FILE* file, const char* filename, bool* mapped);
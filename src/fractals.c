@@ -5,13 +5,37 @@
 #include <getopt.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include "grids.h"
 #include "precision.h"
 #include "fractals.h"
+#include "cpu_dispatch.h"
+#include "high_precision.h"
+#include "perturbation.h"
 
 #define EXIT_BAD_ARGUMENT 2
 
+// values for long options that have no short option
+enum {
+    OPT_ISA = 256,
+    OPT_SUBDIVIDE,
+    OPT_INTERIOR_CHECK,
+    OPT_CYCLE_CHECK,
+    OPT_CHUNKED,
+    OPT_COMPRESS,
+    OPT_PERTURBATION,
+    OPT_SERIES_APPROXIMATION,
+    OPT_AUTO_PRECISION,
+    OPT_PLAN,
+    OPT_COST_MAP,
+    OPT_STATE,
+    OPT_RESUME,
+    OPT_HISTOGRAM,
+    OPT_CENTER
+};
+
 #ifndef NUM_RUNS
 #define NUM_RUNS 5
 #endif
@@ -40,7 +64,29 @@ void print_help(){
             "  -o, --output <filename>         the output filename (default: fractal.grid)\n"
             "  -f, --fractal <type>            the fractal type (default: mandelbrot)\n"
             "      supported fractals: mandelbrot, tricorn, multibrot, multicorn, burning_ship, julia\n"
+            "      and fixed point versions for deeper zooms: mandelbrot_fixed, tricorn_fixed, burning_ship_fixed\n"
             "  -p, --performance               print performance info\n"
+            "      --subdivide                 fill uniform regions by rectangle subdivision (mandelbrot, tricorn, julia)\n"
+            "      --interior-check            skip points in the main cardioid and period 2 bulb (mandelbrot, multibrot of degree 2)\n"
+            "      --cycle-check               stop iterating points whose orbit becomes periodic\n"
+            "      --perturbation              iterate points as differences from high precision reference orbits, for deep zooms\n"
+            "                                  (mandelbrot, tricorn, multibrot and multicorn of an integer degree)\n"
+            "      --series-approximation      start --perturbation points after the iterations a series in their offset approximates\n"
+            "                                  (mandelbrot and multibrot)\n"
+            "      --auto-precision            iterate each grid in the cheapest of float, double and long double that resolves its points\n"
+            "                                  (approximate: float grids differ from double ones near the boundary of the set)\n"
+            "      --plan                      balance the tiles between threads by their cost in a coarse preview (shared-fractals)\n"
+            "      --cost-map <filename>       write the predicted and actual cost of every --plan work unit as csv, implies --plan\n"
+            "      --state <filename>          save the z of the points that have not escaped, so the grid can be continued with --resume\n"
+            "      --resume <filename>         continue a grid saved with --state to the iterations of -i, reading its state from --state\n"
+            "                                  and writing the new state back to it (vectorized double and float kernels only)\n"
+            "                                  (the grid keeps its resolution and view, -x, -y, -l, -u, -z and --center must match them)\n"
+            "      --histogram <filename>      write the histogram of the iterations of the grid, for fractal-render --histogram\n"
+            "      --center <value>            move the view to this center, which is read in high precision for --perturbation\n"
+            "      --chunked                   write the grid in the chunked .grid format, which supports reading regions\n"
+            "      --compress                  write the grid in the chunked .grid format with run length coded chunks\n"
+            "      --isa <name>                the instruction set for the kernels (default: auto)\n"
+            "      supported instruction sets: auto, avx512, avx2, sse2\n"
             "  -v, --verbose                   verbose output\n"
             "  -h, --help                      prints this help message\n"
             "\ndegree is mutually exclusive with constant and radius\n"
@@ -53,10 +99,12 @@ void print_help(){
 void print_info(const char* program_name){
 #ifdef EXTENDED_PRECISION
     printf("Compiled with long double float precision\n");
-#endif
-#ifndef EXTENDED_PRECISION
+#elif defined(DOUBLE_DOUBLE_PRECISION)
+    printf("%s complied with double-double float precision\n", program_name);
+#else
     printf("%s complied with double float precision\n", program_name);
 #endif
+    printf("Using %s kernels, %d points per vector\n", row_kernels->isa, row_kernels->vector_width);
 }
 
 /*
@@ -72,7 +120,81 @@ double time_fractal(fractal_generator generator, grid_t* grid, grid_gen_params*
     return (end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) * 1.0e-9) / NUM_RUNS;
 }
 
+/*
+ * Checks if an output file is a regular file or does not exist yet, only those can be generated into a mapping of the file
+ */
+static bool regular_output(const char* filename){
+    struct stat file_stat;
+    if(stat(filename, &file_stat) != 0) return errno == ENOENT;
+    return S_ISREG(file_stat.st_mode);
+}
+
+/*
+ * Reads a grid saved with --state and its state, raising the max_iterations of the grid so its bounded points continue
+ * Returns NULL if either can not be read or they were not saved together with the same fractal
+ */
+static grid_t* read_resumed_grid(const char* grid_filename, const char* state_filename, const state_origin origin, const byte iterations, iteration_state** state){
+    FILE* grid_file = fopen(grid_filename, "rb");
+    FILE* state_file = fopen(state_filename, "rb");
+    if(!grid_file || !state_file){
+        perror("Error occured while trying to read the grid to resume");
+        if(grid_file) fclose(grid_file);
+        if(state_file) fclose(state_file);
+        return NULL;
+    }
+    grid_t* grid = read_grid(grid_file);
+    *state = read_iteration_state(state_file);
+    fclose(grid_file);
+    fclose(state_file);
+    if(!grid || !*state){
+        free_grid(grid);
+        free_iteration_state(*state);
+        *state = NULL;
+        return NULL;
+    }
+
+    if(!state_matches(*state, grid, origin)){
+        fprintf(stderr, "%s was not saved from %s with the same fractal, parameters and --interior-check\n", state_filename, grid_filename);
+    }
+    else if(iterations < grid->max_iterations){
+        fprintf(stderr, "Can not resume %s with fewer iterations than its %hhu\n", grid_filename, grid->max_iterations);
+    }
+    else {
+        grid->max_iterations = iterations;
+        (*state)->data = grid->data;
+        return grid;
+    }
+    free_grid(grid);
+    free_iteration_state(*state);
+    *state = NULL;
+    return NULL;
+}
+
+/*
+ * Converts high precision numbers to a complex_t, keeping the digits past a double in the low parts
+ */
+#ifdef DOUBLE_DOUBLE_PRECISION
+static inline complex_t hp_to_complex(const hp_real re, const hp_real im){
+    const double re_hi = hp_to_double(re);
+    const double im_hi = hp_to_double(im);
+    return (complex_t){
+        .re = re_hi,
+        .im = im_hi,
+        .re_lo = hp_to_double(hp_sub(re, hp_from_double(re_hi))),
+        .im_lo = hp_to_double(hp_sub(im, hp_from_double(im_hi)))
+    };
+}
+#endif
+
 static inline void parse_complex(const char* string, complex_t* z){
+#ifdef DOUBLE_DOUBLE_PRECISION
+    // the digits past the precision of a double are kept in the low parts
+    hp_real re, im;
+    if(hp_parse_complex(string, &re, &im)){
+        *z = hp_to_complex(re, im);
+        return;
+    }
+#endif
     if(sscanf(string, CFORMAT "+" CFORMAT "i", &z->re, &z->im) != 2){
         fprintf(stderr, "Failed while parsing complex number: %s , is it formatted correctly?\n", string);
         exit(EXIT_FAILURE);
@@ -83,7 +205,17 @@ static inline void parse_complex(const char* string, complex_t* z){
  * Parses a fractal generator form a string, exitting if it is supplied a parameter which it doesn't support
  */
 fractal_generator parse_fractal_generator(const char* argument, const bool param_is_degree, const bool param_is_cr){
-    if(strncmp(argument, "mandelbrot", strlen("mandelbrot")) == 0) {
+    // the fixed point names start with the names of the other fractals, so they are matched first
+    if(strncmp(argument, "mandelbrot_fixed", strlen("mandelbrot_fixed")) == 0) {
+        return mandelbrot_fixed_grid;
+    }
+    else if(strncmp(argument, "tricorn_fixed", strlen("tricorn_fixed")) == 0) {
+        return tricorn_fixed_grid;
+    }
+    else if(strncmp(argument, "burning_ship_fixed", strlen("burning_ship_fixed")) == 0) {
+        return burning_ship_fixed_grid;
+    }
+    else if(strncmp(argument, "mandelbrot", strlen("mandelbrot")) == 0) {
         return mandelbrot_grid;
     }
     else if(strncmp(argument, "tricorn", strlen("tricorn")) == 0) {
@@ -133,6 +265,22 @@ int main(const int argc, char *argv[]) {
     CBASE magnification = 1;
     bool verbose = false;
     bool performance = false;
+    bool subdivide = false;
+    bool interior_check = false;
+    bool cycle_check = false;
+    bool chunked = false;
+    bool compress = false;
+    bool perturbation = false;
+    bool series_approximation = false;
+    bool auto_precision = false;
+    bool plan = false;
+    bool has_center = false;
+    // whether the resolution and view were given, a resumed grid keeps its own and rejects others
+    bool has_x_res = false;
+    bool has_y_res = false;
+    bool has_view = false;
+    perturbation_view view_center = { 0 };
+    grid_gen_stats stats = { 0 };
 
     //degree is mutually exclusive with constant and radius
     //this could be simplified if grid_gen_params was a struct instead of a union but ¯\_(ツ)_/¯
@@ -145,6 +293,11 @@ int main(const int argc, char *argv[]) {
     char* fractal_name = "mandelbrot";
     fractal_generator generator = mandelbrot_grid;
     char* output_filename = "fractal.grid";
+    char* cost_map_filename = NULL;
+    char* state_filename = NULL;
+    char* resume_filename = NULL;
+    char* histogram_filename = NULL;
+    char* isa = NULL;
 
     grid_gen_params* params = malloc(sizeof(grid_gen_params));
     if(!params){
@@ -167,6 +320,21 @@ int main(const int argc, char *argv[]) {
         {"performance", no_argument, NULL, 'p'},
         {"help", no_argument, NULL, 'h'},
         {"fractal", required_argument, NULL, 'f'},
+        {"isa", required_argument, NULL, OPT_ISA},
+        {"subdivide", no_argument, NULL, OPT_SUBDIVIDE},
+        {"interior-check", no_argument, NULL, OPT_INTERIOR_CHECK},
+        {"cycle-check", no_argument, NULL, OPT_CYCLE_CHECK},
+        {"chunked", no_argument, NULL, OPT_CHUNKED},
+        {"compress", no_argument, NULL, OPT_COMPRESS},
+        {"perturbation", no_argument, NULL, OPT_PERTURBATION},
+        {"series-approximation", no_argument, NULL, OPT_SERIES_APPROXIMATION},
+        {"auto-precision", no_argument, NULL, OPT_AUTO_PRECISION},
+        {"plan", no_argument, NULL, OPT_PLAN},
+        {"cost-map", required_argument, NULL, OPT_COST_MAP},
+        {"state", required_argument, NULL, OPT_STATE},
+        {"resume", required_argument, NULL, OPT_RESUME},
+        {"histogram", required_argument, NULL, OPT_HISTOGRAM},
+        {"center", required_argument, NULL, OPT_CENTER},
         {0, 0, 0, 0} // Termination element
     };
 
@@ -187,15 +355,19 @@ int main(const int argc, char *argv[]) {
                 break;
             case 'x':
                 x_res = strtoull(optarg, NULL, 10);
+                has_x_res = true;
                 break;
             case 'y':
                 y_res = strtoull(optarg, NULL, 10);
+                has_y_res = true;
                 break;
             case 'l':
                 parse_complex(optarg, &lower_left);
+                has_view = true;
                 break;
             case 'u':
                 parse_complex(optarg, &upper_right);
+                has_view = true;
                 break;
             case 'o':
                 output_filename = optarg;
@@ -243,6 +415,7 @@ int main(const int argc, char *argv[]) {
                     fprintf(stderr, "Invalid magnification "CFORMAT", exitting\n", magnification);
                     exit(EXIT_BAD_ARGUMENT);
                 }
+                has_view = true;
                 break;
             case 'v':
                 verbose = true;
@@ -250,6 +423,58 @@ int main(const int argc, char *argv[]) {
             case 'p':
                 performance = true;
                 break;
+            case OPT_SUBDIVIDE:
+                subdivide = true;
+                break;
+            case OPT_INTERIOR_CHECK:
+                interior_check = true;
+                break;
+            case OPT_CYCLE_CHECK:
+                cycle_check = true;
+                break;
+            case OPT_CHUNKED:
+                chunked = true;
+                break;
+            case OPT_COMPRESS:
+                chunked = true;
+                compress = true;
+                break;
+            case OPT_PERTURBATION:
+                perturbation = true;
+                break;
+            case OPT_SERIES_APPROXIMATION:
+                series_approximation = true;
+                break;
+            case OPT_AUTO_PRECISION:
+                auto_precision = true;
+                break;
+            case OPT_PLAN:
+                plan = true;
+                break;
+            case OPT_COST_MAP:
+                plan = true;
+                cost_map_filename = optarg;
+                break;
+            case OPT_STATE:
+                state_filename = optarg;
+                break;
+            case OPT_RESUME:
+                resume_filename = optarg;
+                break;
+            case OPT_HISTOGRAM:
+                histogram_filename = optarg;
+                break;
+            case OPT_CENTER:
+                if(!hp_parse_complex(optarg, &view_center.center_re, &view_center.center_im)){
+                    fprintf(stderr, "Failed to parse center: %s, exitting\n", optarg);
+                    exit(EXIT_BAD_ARGUMENT);
+                }
+                has_center = true;
+                has_view = true;
+                break;
+            case OPT_ISA:
+                isa = optarg;
+                break;
             case 'h':
                 print_usage(stdout, argv[0]);
                 print_help();
@@ -260,6 +485,72 @@ int main(const int argc, char *argv[]) {
         }
     }
 
+    if(!select_kernels(isa)){
+        exit(EXIT_BAD_ARGUMENT);
+    }
+
+    if(subdivide && generator != mandelbrot_grid && generator != tricorn_grid && generator != julia_grid){
+        fprintf(stderr, "--subdivide is only supported by the mandelbrot, tricorn, and julia fractals, exitting\n");
+        exit(EXIT_BAD_ARGUMENT);
+    }
+    if(perturbation){
+        const bool integer_degree = degree == (int)degree && degree >= 2 && degree <= MAX_PERTURBATION_DEGREE;
+        if(generator != mandelbrot_grid && generator != tricorn_grid &&
+                !((generator == multibrot_grid || generator == multicorn_grid) && integer_degree)){
+            fprintf(stderr, "--perturbation is only supported by the mandelbrot and tricorn fractals, "
+                    "and multibrot and multicorn with an integer degree from 2 to %d, exitting\n", MAX_PERTURBATION_DEGREE);
+            exit(EXIT_BAD_ARGUMENT);
+        }
+        if(subdivide){
+            fprintf(stderr, "--perturbation can not be used with --subdivide, exitting\n");
+            exit(EXIT_BAD_ARGUMENT);
+        }
+        if(auto_precision){
+            fprintf(stderr, "--perturbation can not be used with --auto-precision, exitting\n");
+            exit(EXIT_BAD_ARGUMENT);
+        }
+    }
+    if(plan && (subdivide || perturbation)){
+        fprintf(stderr, "--plan can not be used with --subdivide or --perturbation, exitting\n");
+        exit(EXIT_BAD_ARGUMENT);
+    }
+    if(resume_filename && !state_filename){
+        fprintf(stderr, "--resume requires the --state of the grid, exitting\n");
+        exit(EXIT_BAD_ARGUMENT);
+    }
+    if(state_filename){
+#if defined(EXTENDED_PRECISION) || defined(DOUBLE_DOUBLE_PRECISION)
+        fprintf(stderr, "--state is only supported by the double precision build, exitting\n");
+        exit(EXIT_BAD_ARGUMENT);
+#endif
+        if(generator == mandelbrot_fixed_grid || generator == tricorn_fixed_grid || generator == burning_ship_fixed_grid ||
+                ((generator == multibrot_grid || generator == multicorn_grid) && degree <= 0)){
+            fprintf(stderr, "--state is not supported by the fixed point fractals, or multibrot and multicorn of a degree below 0, exitting\n");
+            exit(EXIT_BAD_ARGUMENT);
+        }
+        if(subdivide || cycle_check || perturbation || auto_precision || performance){
+            fprintf(stderr, "--state can not be used with --subdivide, --cycle-check, --perturbation, --auto-precision or -p, exitting\n");
+            exit(EXIT_BAD_ARGUMENT);
+        }
+    }
+    if(series_approximation && !perturbation){
+        fprintf(stderr, "--series-approximation requires --perturbation, exitting\n");
+        exit(EXIT_BAD_ARGUMENT);
+    }
+    params->flags = (subdivide ? GEN_SUBDIVIDE : 0) | (interior_check ? GEN_INTERIOR_CHECK : 0) | (cycle_check ? GEN_CYCLE_CHECK : 0) |
+        (perturbation ? GEN_PERTURBATION : 0) | (series_approximation ? GEN_SERIES_APPROXIMATION : 0) | (auto_precision ? GEN_AUTO_PRECISION : 0) |
+        (plan ? GEN_COST_PLAN : 0);
+    params->stats = &stats;
+    params->view = NULL;
+    params->cost_map = NULL;
+    params->state = NULL;
+    if(cost_map_filename){
+        params->cost_map = fopen(cost_map_filename, "w");
+        if(!params->cost_map){
+            perror("Error occured while trying to open the cost map");
+        }
+    }
+
     if(param_is_degree){
         params->degree = degree;
     }
@@ -268,52 +559,176 @@ int main(const int argc, char *argv[]) {
         params->cr.radius = radius;
     }
 
-    grid_t* grid = create_grid(x_res, y_res, iterations, lower_left, upper_right);
-    if(!grid) return 1;
-
+    // what the points of the state are iterated with, interior checked points are not iterated so the flag has to match
+    state_origin origin = { .flags = params->flags & GEN_INTERIOR_CHECK, .degree = degree, .constant = constant, .radius = radius };
+    strncpy(origin.fractal, fractal_name, STATE_FRACTAL_SIZE - 1);
 
+    // a grid without data only holds the view, zooming it just moves the corners
+    grid_t view = { .lower_left = lower_left, .upper_right = upper_right };
     if(magnification != 1){
-        zoom_grid(grid, magnification);
+        zoom_grid(&view, magnification);
+    }
+
+    // the corners are also zoomed relative to their center, which keeps the size of the view at zooms too deep for the corners
+    if(has_center || perturbation){
+        const complex_t middle = { .re = 0.5 * (lower_left.re + upper_right.re), .im = 0.5 * (lower_left.im + upper_right.im) };
+        grid_t offsets = {
+            .lower_left = { .re = lower_left.re - middle.re, .im = lower_left.im - middle.im },
+            .upper_right = { .re = upper_right.re - middle.re, .im = upper_right.im - middle.im }
+        };
+        if(magnification != 1){
+            zoom_grid(&offsets, magnification);
+        }
+        view_center.lower_left_offset = offsets.lower_left;
+        view_center.upper_right_offset = offsets.upper_right;
+
+        if(has_center){
+#ifdef DOUBLE_DOUBLE_PRECISION
+            view.lower_left = hp_to_complex(hp_add(view_center.center_re, hp_from_double(offsets.lower_left.re)),
+                    hp_add(view_center.center_im, hp_from_double(offsets.lower_left.im)));
+            view.upper_right = hp_to_complex(hp_add(view_center.center_re, hp_from_double(offsets.upper_right.re)),
+                    hp_add(view_center.center_im, hp_from_double(offsets.upper_right.im)));
+#else
+            const CBASE center_re = hp_to_double(view_center.center_re);
+            const CBASE center_im = hp_to_double(view_center.center_im);
+            view.lower_left = (complex_t){ .re = center_re + offsets.lower_left.re, .im = center_im + offsets.lower_left.im };
+            view.upper_right = (complex_t){ .re = center_re + offsets.upper_right.re, .im = center_im + offsets.upper_right.im };
+#endif
+        }
+        else {
+            view_center.center_re = hp_half(hp_add(complex_to_hp_re(lower_left), complex_to_hp_re(upper_right)));
+            view_center.center_im = hp_half(hp_add(complex_to_hp_im(lower_left), complex_to_hp_im(upper_right)));
+        }
+        params->view = &view_center;
+    }
+
+    // a flat grid that is saved to a regular file is generated directly into a mapping of the file instead of being written after,
+    // devices and pipes like /dev/null can not be mapped and are written as usual
+    // strnlen is used in case a user can pass a non-null terminated string, though that would likely break getopt first
+    const bool to_stdout = output_filename[0] == '-' && strnlen(output_filename, 16) == 1;
+    bool mapped = !performance && !to_stdout && !chunked && !resume_filename && regular_output(output_filename);
+    grid_t* grid;
+    // --resume always comes with --state, see the argument checks above
+    if(resume_filename && state_filename){
+        grid = read_resumed_grid(resume_filename, state_filename, origin, iterations, &params->state);
+        // the resumed grid keeps its resolution and view, so any other one given to it is an error rather than ignored
+        if(grid && ((has_x_res && x_res != grid->x) || (has_y_res && y_res != grid->y) ||
+                (has_view && (view.lower_left.re != grid->lower_left.re || view.lower_left.im != grid->lower_left.im ||
+                    view.upper_right.re != grid->upper_right.re || view.upper_right.im != grid->upper_right.im)))){
+            fprintf(stderr, "-x, -y, -l, -u, -z and --center must match the %zux%zu grid from ("CFORMAT", "CFORMAT") to ("CFORMAT", "CFORMAT") in %s, exitting\n",
+                    grid->x, grid->y, grid->lower_left.re, grid->lower_left.im, grid->upper_right.re, grid->upper_right.im, resume_filename);
+            exit(EXIT_BAD_ARGUMENT);
+        }
     }
+    else {
+        grid = mapped ? create_mapped_grid(output_filename, x_res, y_res, iterations, view.lower_left, view.upper_right) : NULL;
+        if(mapped && !grid){
+            fprintf(stderr, "Could not map %s, the grid is written after it is generated instead\n", output_filename);
+            mapped = false;
+        }
+        if(!mapped){
+            grid = create_grid(x_res, y_res, iterations, view.lower_left, view.upper_right);
+        }
+        if(grid && state_filename){
+            params->state = create_iteration_state(grid, origin);
+            if(!params->state) return 1;
+        }
+    }
+    if(!grid) return 1;
 
     generator(grid, params);
+    // only the first grid writes its cost map, the timed runs below would overwrite it
+    if(params->cost_map){
+        fclose(params->cost_map);
+        params->cost_map = NULL;
+    }
+    // the timed runs below keep adding to the counters, so keep the counts for a single grid
+    const grid_gen_stats grid_stats = stats;
 
     if(performance){
         double time = time_fractal(generator, grid, params);
         printf("%s,%s,%lf,"CFORMAT","CFORMAT",%lf,%hhu,%zu,%zu,",
                 argv[0], fractal_name, degree, constant.re, constant.im, radius, iterations, x_res, y_res);
-        printf(CFORMAT","CFORMAT","CFORMAT","CFORMAT",%f\n",
-                lower_left.re, lower_left.im, upper_right.re, upper_right.im, time);
+        printf(CFORMAT","CFORMAT","CFORMAT","CFORMAT",%f,%zu\n",
+                lower_left.re, lower_left.im, upper_right.re, upper_right.im, time, grid_stats.interior_points);
     }
 
     if(verbose){
         print_info(argv[0]);
         printf("Magnification:\t"CFORMAT"\n", magnification);
+        printf("Interior points skipped:\t%zu\n", grid_stats.interior_points);
+        if(perturbation){
+            printf("Perturbation references:\t%zu\n", grid_stats.references);
+        }
+        if(grid_stats.mirrored_rows){
+            printf("Mirrored rows:\t%zu\n", grid_stats.mirrored_rows);
+        }
+        if(grid_stats.steals){
+            printf("Work steals:\t%zu\n", grid_stats.steals);
+        }
+        if(grid_stats.precision){
+            printf("Precision:\t%s\n", grid_stats.precision);
+        }
+        if(grid_stats.fixed_point_bits){
+            printf("Fixed point:\t%zu bits\n", grid_stats.fixed_point_bits);
+        }
+        if(series_approximation){
+            printf("Series approximation skipped:\t%zu iterations\n", grid_stats.series_iterations);
+        }
         print_grid_info(grid);
     }
 
-    if(!performance){
-        //uses "safer" versions of c string functions
-        //likely aren't necessary unless a user can pass non-null terminated strings as arguments, but that would likely break something up in getopt
-        if(output_filename[0] == '-' && strnlen(output_filename, 16) == 1){
-            if(write_grid(stdout, grid) == GRID_WRITE_ERROR){
+    if(!performance && !mapped){
+        FILE* file = to_stdout ? stdout : fopen(output_filename, "wb");
+        if(!file){
+            perror("Error occured while trying to write");
+        }
+        else {
+            const int status = chunked ? write_chunked_grid(file, grid, compress) : write_grid(file, grid);
+            if(status == GRID_WRITE_ERROR){
                 fprintf(stderr, "Error occured while writting to file %s\n", output_filename);
             }
+            if(file != stdout) fclose(file);
+        }
+    }
+
+    // the histogram is counted in a separate parallel pass over the finished grid, the kernels do not count while they fill it
+    if(histogram_filename){
+        size_t histogram[256];
+        grid_histogram(grid, histogram);
+        FILE* file = fopen(histogram_filename, "wb");
+        if(!file){
+            perror("Error occured while trying to write the histogram");
         }
         else {
-            FILE* file = fopen(output_filename, "wb");
-            if(!file){
-                perror("Error occured while trying to write");
+            if(write_histogram(file, grid, histogram) == GRID_WRITE_ERROR){
+                fprintf(stderr, "Error occured while writting the histogram to %s\n", histogram_filename);
             }
-            else if(write_grid(file, grid) == GRID_WRITE_ERROR){
-                fprintf(stderr, "Error occured while writting to file %s\n", output_filename);
+            fclose(file);
+        }
+    }
+
+    if(params->state && state_filename){
+        FILE* file = fopen(state_filename, "wb");
+        if(!file){
+            perror("Error occured while trying to write the state");
+        }
+        else {
+            if(write_iteration_state(file, params->state, grid) == STATE_WRITE_ERROR){
+                fprintf(stderr, "Error occured while writting the state to %s\n", state_filename);
             }
             fclose(file);
         }
+        free_iteration_state(params->state);
     }
 
     free(params);
-    free_grid(grid);
+    if(mapped){
+        unmap_grid(grid);
+    }
+    else {
+        free_grid(grid);
+    }
 
     return 0;
 }
@@ -7,13 +7,72 @@
 
 #include "grids.h"
 #include "precision.h"
+#include "high_precision.h"
+#include "iteration_state.h"
 
-typedef union {
-    CBASE degree;
-    struct {
-        complex_t constant;
-        double radius;
-    } cr ;
+// flags that change how a grid is generated
+#define GEN_SUBDIVIDE 0x1
+#define GEN_INTERIOR_CHECK 0x2
+#define GEN_CYCLE_CHECK 0x4
+#define GEN_PERTURBATION 0x8
+#define GEN_SERIES_APPROXIMATION 0x10
+#define GEN_AUTO_PRECISION 0x20
+#define GEN_COST_PLAN 0x40
+
+// the mantissa bits GEN_AUTO_PRECISION keeps below the step between two points and the rounding error of the iterations
+#ifndef PRECISION_GUARD_BITS
+#define PRECISION_GUARD_BITS 4
+#endif
+
+// how close two points of an orbit must be for GEN_CYCLE_CHECK to treat the orbit as periodic
+#ifndef CYCLE_TOLERANCE
+#define CYCLE_TOLERANCE (64 * CEPSILON)
+#endif
+
+// counters that are filled in while a grid is generated
+typedef struct {
+    size_t interior_points;
+    size_t references;
+    // the iterations skipped by the series approximation of the first reference orbit
+    size_t series_iterations;
+    // the size of the fixed point numbers chosen by the fixed point kernels
+    size_t fixed_point_bits;
+    // the arithmetic chosen by GEN_AUTO_PRECISION
+    const char* precision;
+    // the times a thread stole tiles or rows from another, see work_stealing.h
+    size_t steals;
+    // the rows copied from the rows they mirror instead of being iterated, see mirror_grid_coords
+    size_t mirrored_rows;
+} grid_gen_stats;
+
+// the view of a GEN_PERTURBATION grid, whose center may be too precise for the corners of the grid to hold
+typedef struct {
+    hp_real center_re;
+    hp_real center_im;
+    // the corners of the grid relative to the center
+    complex_t lower_left_offset;
+    complex_t upper_right_offset;
+} perturbation_view;
+
+typedef struct {
+    union {
+        CBASE degree;
+        struct {
+            complex_t constant;
+            double radius;
+        } cr ;
+    };
+    unsigned int flags;
+    grid_gen_stats* stats;
+    // the view used by GEN_PERTURBATION, if NULL the view is taken from the corners of the grid
+    const perturbation_view* view;
+    // the lower left corner of the grid, set while it is traversed
+    // the coordinates handed to kernels with offset_coordinates are offsets from it, see create_grid_coords
+    complex_t origin;
+    // where GEN_COST_PLAN writes the predicted and actual cost of its work units, if not NULL
+    FILE* cost_map;
+    // the state the points are saved to and, if it is resumed, continued from, see iteration_state.h
+    iteration_state* state;
 } grid_gen_params ;
 
 typedef void (*fractal_generator)(grid_t* , const grid_gen_params* );
@@ -25,6 +84,46 @@ byte burning_ship(const CBASE complex z0, const byte max_iterations);
 byte multibrot(const CBASE complex z0, const byte max_iterations, const double d);
 byte multicorn(const CBASE complex z0, const byte max_iterations, const double d);
 byte julia(const CBASE complex z0, const CBASE complex c, const byte max_iterations, const double R);
+
+/*
+ * Checks if a point lies within the main cardioid or the period 2 bulb of the mandelbrot set
+ * Points that pass never escape, so they can be assigned max_iterations without iterating
+ */
+static inline bool in_mandelbrot_interior(const CBASE x, const CBASE y){
+    const CBASE y2 = y * y;
+    const CBASE x_shift = x - 0.25;
+    const CBASE q = x_shift * x_shift + y2;
+    const CBASE x_bulb = x + 1;
+    return q * (q + x_shift) < 0.25 * y2 || x_bulb * x_bulb + y2 < 0.0625;
+}
+
+/*
+ * Adds to the count of points that were found by in_mandelbrot_interior, safe to call from multiple threads
+ */
+static inline void add_interior_points(const grid_gen_params* params, const size_t count){
+    if(params->stats && count){
+        __atomic_fetch_add(&params->stats->interior_points, count, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Converts the components of a complex_t to high precision numbers, including the low parts of double-double components
+ */
+static inline hp_real complex_to_hp_re(const complex_t z){
+#ifdef DOUBLE_DOUBLE_PRECISION
+    return hp_add(hp_from_double(z.re), hp_from_double(z.re_lo));
+#else
+    return hp_from_double(z.re);
+#endif
+}
+
+static inline hp_real complex_to_hp_im(const complex_t z){
+#ifdef DOUBLE_DOUBLE_PRECISION
+    return hp_add(hp_from_double(z.im), hp_from_double(z.im_lo));
+#else
+    return hp_from_double(z.im);
+#endif
+}
 #endif
 
 #ifdef __cplusplus
@@ -36,6 +135,9 @@ void burning_ship_grid(grid_t* grid, const grid_gen_params* params);
 void multibrot_grid(grid_t* grid, const grid_gen_params* params);
 void multicorn_grid(grid_t* grid, const grid_gen_params* params);
 void julia_grid(grid_t* grid, const grid_gen_params* params);
+void mandelbrot_fixed_grid(grid_t* grid, const grid_gen_params* params);
+void tricorn_fixed_grid(grid_t* grid, const grid_gen_params* params);
+void burning_ship_fixed_grid(grid_t* grid, const grid_gen_params* params);
 #ifdef __cplusplus
 }
 #endif
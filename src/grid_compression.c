@@ -0,0 +1,75 @@
+/*
+ * Run length coding of grid points
+ *
+ * The coded points are a sequence of strings, each starting with a control byte
+ * A control byte below 128 is followed by control + 1 literal points
+ * A control byte of 128 or above is followed by a single point which is repeated control - 125 times
+ */
+#include <string.h>
+#include "grid_compression.h"
+
+#define MAX_LITERAL 128
+#define MIN_RUN 3
+#define MAX_RUN (255 - 128 + MIN_RUN)
+
+static inline size_t run_length(const byte* points, const size_t start, const size_t size, const size_t max){
+    size_t length = 1;
+    while(start + length < size && length < max && points[start + length] == points[start]){
+        length++;
+    }
+    return length;
+}
+
+/*
+ * Codes size points into out, which must hold at least COMPRESSED_BOUND(size) bytes
+ * Returns the size of the coded points
+ */
+size_t compress_points(const byte* points, const size_t size, byte* out){
+    size_t in = 0;
+    size_t written = 0;
+    while(in < size){
+        const size_t run = run_length(points, in, size, MAX_RUN);
+        if(run >= MIN_RUN){
+            out[written++] = 128 + run - MIN_RUN;
+            out[written++] = points[in];
+            in += run;
+            continue;
+        }
+
+        // a literal string lasts until the next run worth coding
+        const size_t start = in;
+        while(in < size && in - start < MAX_LITERAL && run_length(points, in, size, MIN_RUN) < MIN_RUN){
+            in++;
+        }
+        out[written++] = in - start - 1;
+        memcpy(out + written, points + start, in - start);
+        written += in - start;
+    }
+    return written;
+}
+
+/*
+ * Decodes in_size bytes of coded points into exactly size points
+ * Returns false if the coded points are malformed or do not decode to size points
+ */
+bool decompress_points(const byte* in, const size_t in_size, byte* points, const size_t size){
+    size_t read = 0;
+    size_t out = 0;
+    while(read < in_size){
+        const byte control = in[read++];
+        if(control < 128){
+            const size_t length = control + 1;
+            if(read + length > in_size || out + length > size) return false;
+            memcpy(points + out, in + read, length);
+            read += length;
+            out += length;
+        }
+        else {
+            const size_t length = control - 128 + MIN_RUN;
+            if(read >= in_size || out + length > size) return false;
+            memset(points + out, in[read++], length);
+            out += length;
+        }
+    }
+    return out == size;
+}
@@ -0,0 +1,18 @@
+/*
+ * Run length coding for the chunks of chunked grids
+ *
+ * Grids are mostly long runs of the same iteration count, which are stored as a count and a value.
+ * Points that are not part of a run are stored as literal strings of up to 128 points.
+ * Each chunk is coded on its own, so chunks can be compressed and decompressed in parallel
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "grids.h"
+
+// the largest size that size points can be coded to, when no point is part of a run
+#define COMPRESSED_BOUND(size) ((size) + ((size) + 127) / 128)
+
+size_t compress_points(const byte* points, const size_t size, byte* out);
+bool decompress_points(const byte* in, const size_t in_size, byte* points, const size_t size);
@@ -2,11 +2,17 @@
  * Functions for the creation, manipulation, and evaluation of grids.
  */
 #include <complex.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "grids.h"
+#include "grid_compression.h"
 
 static inline bool equal_complex_t(const complex_t z1, const complex_t z2){
     return z1.re == z2.re && z1.im == z2.im;
@@ -128,7 +134,7 @@ CBASE complex grid_to_complex(const grid_t* grid_p, const size_t index) {
     const CBASE y_step = (y_max - y_min) / (double)y_res;
 
     const size_t x_index = index % x_res;
-    const size_t y_index = index / y_res;
+    const size_t y_index = index / x_res;
 
     const CBASE x = x_min + x_index * x_step;
     const CBASE y = y_min + y_index * y_step;
@@ -150,6 +156,15 @@ void zoom_grid(grid_t* restrict grid, const CBASE magnification){
 
     const CBASE inv2 = 1 / 2.0;
     const CBASE inv_mag = 1 / magnification;
+#ifdef DOUBLE_DOUBLE_PRECISION
+    // the low parts of the corners are kept by zooming in double-double
+    const double_double center_re = dd_mul_double(dd_add(dd_real(lower_left), dd_real(upper_right)), inv2);
+    const double_double center_im = dd_mul_double(dd_add(dd_imag(lower_left), dd_imag(upper_right)), inv2);
+    const double_double offset_re = dd_mul_double(dd_sub(dd_real(upper_right), dd_real(lower_left)), inv_mag);
+    const double_double offset_im = dd_mul_double(dd_sub(dd_imag(upper_right), dd_imag(lower_left)), inv_mag);
+    grid->lower_left = dd_complex(dd_sub(center_re, offset_re), dd_sub(center_im, offset_im));
+    grid->upper_right = dd_complex(dd_add(center_re, offset_re), dd_add(center_im, offset_im));
+#else
     const complex_t center = {
         .re = inv2 * (lower_left.re + upper_right.re),
         .im = inv2 * (lower_left.im + upper_right.im)
@@ -167,6 +182,7 @@ void zoom_grid(grid_t* restrict grid, const CBASE magnification){
         .re = center.re + offset.re,
         .im = center.im + offset.im
     };
+#endif
 }
 
 /*
@@ -178,9 +194,11 @@ void zoom_grid(grid_t* restrict grid, const CBASE magnification){
  * The first 3 bytes of the file are a magic number defined in grids.h (a goose !)
  * The next 16 bytes are the grid dimensions (x then y)
  * The next 1 byte is the max_iterations
- * The next 8 bytes are the precision for the complex numbers
- * The next 2*precision bytes are the lower left and upper right corners
+ * The next 8 bytes are the precision for the complex numbers, see GRID_PRECISION
+ * The next 2*sizeof(complex_t) bytes are the lower left and upper right corners
  * The rest of the file is the data for the grid, which should be exactly x*y*8 bytes
+ *
+ * This is the flat (version 1) format, the chunked format is written by write_chunked_grid
  */
 int write_grid(FILE* restrict file, const grid_t *grid){
     if(grid->size == 0 || !grid->data ){
@@ -191,7 +209,7 @@ int write_grid(FILE* restrict file, const grid_t *grid){
     magic_num[0] = 0xA6;
     magic_num[1] = 0x00;
     magic_num[2] = 0x5E;
-    const size_t precision = sizeof(complex_t);
+    const size_t precision = GRID_PRECISION;
 
     if(fwrite(magic_num, 1, 3, file) != 3) return GRID_WRITE_ERROR;
 
@@ -199,8 +217,8 @@ int write_grid(FILE* restrict file, const grid_t *grid){
        fwrite(&grid->y, sizeof(size_t), 1, file) != 1 ||
        fwrite(&grid->max_iterations, sizeof(byte), 1, file) != 1 ||
        fwrite(&precision, sizeof(size_t), 1, file) != 1 ||
-       fwrite(&grid->lower_left, precision, 1, file) != 1 ||
-       fwrite(&grid->upper_right, precision, 1, file) != 1){
+       fwrite(&grid->lower_left, sizeof(complex_t), 1, file) != 1 ||
+       fwrite(&grid->upper_right, sizeof(complex_t), 1, file) != 1){
         return GRID_WRITE_ERROR;
     }
 
@@ -277,13 +295,50 @@ void print_grid(FILE* file, const grid_t* grid){
     free(output_buffer);
 }
 
+// the fields of a .grid header, shared by both versions of the format
+typedef struct {
+    int version;
+    size_t x;
+    size_t y;
+    byte max_iterations;
+    complex_t lower_left;
+    complex_t upper_right;
+    size_t chunk_width;
+    size_t chunk_height;
+} grid_header;
+
+// an entry of the chunk index of a chunked grid
+typedef struct {
+    size_t offset;
+    size_t size;
+} grid_chunk;
+
+static inline size_t chunk_columns(const grid_header* header){
+    return (header->x + header->chunk_width - 1) / header->chunk_width;
+}
+
+static inline size_t chunk_rows(const grid_header* header){
+    return (header->y + header->chunk_height - 1) / header->chunk_height;
+}
+
 /*
- * Creates a grid from a .grid file, reading the amount of data as specified by the file
- * For more details on the .grid format see write_grid
+ * Gets the rectangle of the grid covered by a chunk, chunks on the right and top edges may be smaller than the chunk size
+ */
+static void chunk_rect(const grid_header* header, const size_t chunk, size_t* x, size_t* y, size_t* width, size_t* height){
+    const size_t columns = chunk_columns(header);
+    *x = (chunk % columns) * header->chunk_width;
+    *y = (chunk / columns) * header->chunk_height;
+    *width = header->x - *x < header->chunk_width ? header->x - *x : header->chunk_width;
+    *height = header->y - *y < header->chunk_height ? header->y - *y : header->chunk_height;
+}
+
+/*
+ * Reads the header of a .grid file of either version
+ * For chunked grids the file is left at the start of the chunk index
  *
- * Ignores remainder of file if it has finished reading but is not at the end of the file
+ * Returns false if the file is not a valid grid
  */
-grid_t* read_grid(FILE* restrict file){
+static bool read_grid_header(FILE* restrict file, grid_header* header){
     // Make sure the file has a magic goose (GRID_MAGIC_NUMBER)
     unsigned char magic_num[3];
     size_t read_count = fread(magic_num, 1, 3, file);
@@ -292,52 +347,690 @@ grid_t* read_grid(FILE* restrict file){
 
     if(read_count != 3){
         perror("Error reading file\n");
-        return NULL;
+        return false;
     }
     if(magic_num[0] != 0xA6 || magic_num[1] != 0x00 || magic_num[2] != 0x5E){
         fprintf(stderr, "Error reading file, can't find magic number 0xA6005E\n");
-        return NULL;
+        return false;
     }
 
     if(setjmp(file_read_error)){
         perror("Error reading file\n");
-        return NULL;
+        return false;
     }
 
-    size_t x = 0;
-    size_t y = 0;
-    byte max_iterations = 0;
+    *header = (grid_header){ .version = GRID_VERSION_FLAT };
     size_t precision = 0;
-    if(fread(&x, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
-    if(fread(&y, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
-    if(fread(&max_iterations, sizeof(byte), 1, file) != 1){ longjmp(file_read_error, 1); }
+    if(fread(&header->x, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+
+    // a grid can not be empty, so an x of 0 is followed by the version of the format
+    if(header->x == 0){
+        byte version = 0;
+        if(fread(&version, sizeof(byte), 1, file) != 1){ longjmp(file_read_error, 1); }
+        if(version != GRID_VERSION_CHUNKED){
+            fprintf(stderr, "Unsupported grid version %hhu\n", version);
+            return false;
+        }
+        header->version = version;
+        if(fread(&header->x, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+    }
+
+    if(fread(&header->y, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+    if(fread(&header->max_iterations, sizeof(byte), 1, file) != 1){ longjmp(file_read_error, 1); }
     if(fread(&precision, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1) ; }
 
-    if(precision != sizeof(complex_t)){
-        fprintf(stderr, "File's precisions does not match programs: %zu != %zu\n", precision, sizeof(complex_t));
+    if(precision != GRID_PRECISION){
+        fprintf(stderr, "File's precisions does not match programs: %zu != %zu\n", precision, GRID_PRECISION);
         longjmp(file_read_error, 1);
     }
 
-    complex_t lower_left;
-    complex_t upper_right;
-    if(fread(&lower_left, sizeof(complex_t), 1, file) != 1){ longjmp(file_read_error, 1); }
-    if(fread(&upper_right, sizeof(complex_t), 1, file) != 1){ longjmp(file_read_error, 1); }
-
-    // NOTE: for very large sizes it might make sense to memmap the file
-    //       this would work on the CPU but break the cuda implmentation
-    //       a potential fix would to just make multiple grids, aand stich them in
-    //       after image rendering
-    grid_t* grid = create_grid(x, y, max_iterations, lower_left, upper_right);
+    if(fread(&header->lower_left, sizeof(complex_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+    if(fread(&header->upper_right, sizeof(complex_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+
+    if(header->x == 0 || header->y == 0){
+        fprintf(stderr, "Error reading file, grid can not be empty\n");
+        return false;
+    }
+    if(header->y > SIZE_MAX / header->x){
+        fprintf(stderr, "Error reading file, a %zux%zu grid is too large\n", header->x, header->y);
+        return false;
+    }
+
+    if(header->version == GRID_VERSION_CHUNKED){
+        if(fread(&header->chunk_width, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+        if(fread(&header->chunk_height, sizeof(size_t), 1, file) != 1){ longjmp(file_read_error, 1); }
+        if(header->chunk_width == 0 || header->chunk_height == 0){
+            fprintf(stderr, "Error reading file, chunks can not be empty\n");
+            return false;
+        }
+        // chunks larger than the grid cover the same points as chunks the size of the grid, which keeps the size of
+        // a chunk and of a band of chunks below the size of the grid
+        if(header->chunk_width > header->x) header->chunk_width = header->x;
+        if(header->chunk_height > header->y) header->chunk_height = header->y;
+    }
+    return true;
+}
+
+/*
+ * Reads the chunk index of a chunked grid, the file must be at the start of the index
+ */
+static grid_chunk* read_chunk_index(FILE* restrict file, const grid_header* header){
+    const size_t chunks = chunk_columns(header) * chunk_rows(header);
+    grid_chunk* index = chunks <= SIZE_MAX / sizeof(grid_chunk) ? malloc(chunks * sizeof(grid_chunk)) : NULL;
+    if(!index){
+        fprintf(stderr, "Error allocating index for %zu chunks\n", chunks);
+        return NULL;
+    }
+    if(fread(index, sizeof(grid_chunk), chunks, file) != chunks){
+        perror("Error reading chunk index");
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+/*
+ * Gets the points of a stored chunk, copying or decompressing them into a buffer holding the rows of the chunk back to back
+ * A chunk stored in fewer bytes than it has points is run length coded, see grid_compression.h
+ */
+static bool decode_chunk(const byte* stored, const size_t stored_size, byte* buffer, const size_t size){
+    if(stored_size == size){
+        memcpy(buffer, stored, size);
+        return true;
+    }
+    return stored_size < size && decompress_points(stored, stored_size, buffer, size);
+}
+
+/*
+ * Reads a chunk of a chunked grid into a buffer holding its rows back to back, scratch must hold size bytes
+ */
+static bool read_chunk(FILE* restrict file, const grid_chunk chunk, byte* buffer, byte* scratch, const size_t size){
+    if(chunk.size > size){
+        fprintf(stderr, "Error reading file, expected a chunk of at most %zu bytes but found %zu\n", size, chunk.size);
+        return false;
+    }
+    const size_t read_count = fread(scratch, 1, chunk.size, file);
+    if(read_count != chunk.size){
+        fprintf(stderr, "Error reading file, expected a chunk of %zu bytes but only found %zu\n", chunk.size, read_count);
+        return false;
+    }
+    if(!decode_chunk(scratch, chunk.size, buffer, size)){
+        fprintf(stderr, "Error reading file, malformed compressed chunk\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Creates a grid from a .grid file, reading the amount of data as specified by the file
+ * Both the flat and the chunked version of the format can be read, for more details see write_grid and write_chunked_grid
+ * The chunks of a chunked grid are read in order without seeking, so the file may be a pipe
+ * Compressed chunks are decompressed in parallel, a band of chunks at a time
+ *
+ * Ignores remainder of file if it has finished reading but is not at the end of the file
+ */
+grid_t* read_grid(FILE* restrict file){
+    grid_header header;
+    if(!read_grid_header(file, &header)) return NULL;
+
+    // NOTE: for very large files map_grid avoids reading the data into memory
+    grid_t* grid = create_grid(header.x, header.y, header.max_iterations, header.lower_left, header.upper_right);
     if(!grid){
         return NULL;
     }
 
-    read_count = fread(grid->data, 1, grid->size, file);
-    if(read_count != grid->size){
-        fprintf(stderr, "Error reading file, expected %zu grid points but only found %zu\n", grid->size, read_count);
+    if(header.version == GRID_VERSION_FLAT){
+        const size_t read_count = fread(grid->data, 1, grid->size, file);
+        if(read_count != grid->size){
+            fprintf(stderr, "Error reading file, expected %zu grid points but only found %zu\n", grid->size, read_count);
+            free_grid(grid);
+            return NULL;
+        }
+        return grid;
+    }
+
+    // the chunks are read a band of chunk_height rows at a time, then decoded in parallel
+    // read_grid_header bounds the chunk height by the height of the grid, so a band is at most the size of the grid
+    const size_t columns = chunk_columns(&header);
+    const size_t band_size = header.x * header.chunk_height;
+    grid_chunk* index = read_chunk_index(file, &header);
+    byte* stored = malloc(band_size);
+    byte* decoded = malloc(band_size);
+    // the offset of every chunk of a band into its stored bytes, offsets[columns] is the size of the band
+    size_t* offsets = malloc((columns + 1) * sizeof(size_t));
+    bool success = index && stored && decoded && offsets;
+
+    for(size_t band = 0; success && band < chunk_rows(&header); band++){
+        const grid_chunk* chunks = index + band * columns;
+        offsets[0] = 0;
+        for(size_t i = 0; success && i < columns; i++){
+            // bounding every chunk keeps the sum of the sizes from wrapping around
+            success = chunks[i].size <= band_size;
+            offsets[i + 1] = offsets[i] + chunks[i].size;
+        }
+        const size_t stored_size = offsets[columns];
+        if(!success || stored_size > band_size){
+            fprintf(stderr, "Error reading file, chunks are larger than their points\n");
+            success = false;
+            break;
+        }
+        const size_t read_count = fread(stored, 1, stored_size, file);
+        if(read_count != stored_size){
+            fprintf(stderr, "Error reading file, expected %zu bytes of chunks but only found %zu\n", stored_size, read_count);
+            success = false;
+            break;
+        }
+
+        #pragma omp parallel for default(none) shared(grid, header, band, chunks, columns, offsets, stored, decoded) reduction(&&: success) schedule(dynamic)
+        for(size_t i = 0; i < columns; i++){
+            size_t x, y, width, height;
+            chunk_rect(&header, band * columns + i, &x, &y, &width, &height);
+            byte* points = decoded + i * header.chunk_width * header.chunk_height;
+
+            // a chunk that decodes must not clear the failure of an earlier chunk of the same thread
+            const bool chunk_decoded = decode_chunk(stored + offsets[i], chunks[i].size, points, width * height);
+            success = success && chunk_decoded;
+            for(size_t row = 0; chunk_decoded && row < height; row++){
+                memcpy(grid->data + (y + row) * grid->x + x, points + row * width, width);
+            }
+        }
+        if(!success) fprintf(stderr, "Error reading file, malformed compressed chunk\n");
+    }
+    free(offsets);
+    free(decoded);
+    free(stored);
+    free(index);
+
+    if(!success){
         free_grid(grid);
         return NULL;
     }
+    return grid;
+}
+
+/*
+ * Writes a grid to a file in the chunked (version 2) .grid format
+ *
+ * Returns 0 on success
+ *
+ * The chunked format stores the grid as chunks of GRID_CHUNK_WIDTH by GRID_CHUNK_HEIGHT points so any region of the grid
+ * can be read without reading the rest of the file, see read_grid_region
+ * The first 3 bytes of the file are the magic number
+ * The next 8 bytes are 0, where the flat format stores the x dimension
+ * The next 1 byte is the version of the format
+ * The next bytes are the same as the header of the flat format, from the x dimension to the upper right corner
+ * The next 16 bytes are the chunk dimensions (width then height)
+ * The next 16 bytes per chunk are the index of the chunks, the offset of each chunk from the start of the file then its size
+ * The rest of the file is the data of the chunks, in row major order of chunks with the points of each chunk in row major order
+ *
+ * With compress set, chunks are run length coded (see grid_compression.h) in parallel,
+ * a chunk is only stored coded if that is smaller, which readers detect by its size being smaller than its number of points
+ */
+int write_chunked_grid(FILE* restrict file, const grid_t* grid, const bool compress){
+    if(grid->size == 0 || !grid->data ){
+        return GRID_NO_DATA;
+    }
+
+    const grid_header header = {
+        .version = GRID_VERSION_CHUNKED,
+        .x = grid->x,
+        .y = grid->y,
+        .chunk_width = GRID_CHUNK_WIDTH,
+        .chunk_height = GRID_CHUNK_HEIGHT
+    };
+    const size_t chunks = chunk_columns(&header) * chunk_rows(&header);
+    grid_chunk* index = malloc(chunks * sizeof(grid_chunk));
+    // the stored bytes of each chunk, NULL for chunks that are stored uncompressed
+    byte** coded = calloc(chunks, sizeof(byte*));
+    byte* buffer = malloc(GRID_CHUNK_WIDTH * GRID_CHUNK_HEIGHT);
+    if(!index || !coded || !buffer){
+        free(index);
+        free(coded);
+        free(buffer);
+        return GRID_WRITE_ERROR;
+    }
+
+    #pragma omp parallel default(none) shared(grid, header, chunks, index, coded, compress)
+    {
+        byte* points = compress ? malloc(GRID_CHUNK_WIDTH * GRID_CHUNK_HEIGHT) : NULL;
+
+        #pragma omp for schedule(dynamic)
+        for(size_t i = 0; i < chunks; i++){
+            size_t x, y, width, height;
+            chunk_rect(&header, i, &x, &y, &width, &height);
+            index[i].size = width * height;
+            byte* chunk_coded = points ? malloc(COMPRESSED_BOUND(width * height)) : NULL;
+            if(!chunk_coded) continue;
+
+            for(size_t row = 0; row < height; row++){
+                memcpy(points + row * width, grid->data + (y + row) * grid->x + x, width);
+            }
+            // chunks that do not shrink are stored as they are
+            const size_t coded_size = compress_points(points, width * height, chunk_coded);
+            if(coded_size < width * height){
+                index[i].size = coded_size;
+                coded[i] = chunk_coded;
+            }
+            else {
+                free(chunk_coded);
+            }
+        }
+        free(points);
+    }
+
+    size_t offset = GRID_HEADER_SIZE + sizeof(size_t) + sizeof(byte) + 2 * sizeof(size_t) + chunks * sizeof(grid_chunk);
+    for(size_t i = 0; i < chunks; i++){
+        index[i].offset = offset;
+        offset += index[i].size;
+    }
+
+    const unsigned char magic_num[3] = { 0xA6, 0x00, 0x5E };
+    const size_t version_marker = 0;
+    const byte version = GRID_VERSION_CHUNKED;
+    const size_t precision = GRID_PRECISION;
+
+    int status = 0;
+    if(fwrite(magic_num, 1, 3, file) != 3 ||
+       fwrite(&version_marker, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&version, sizeof(byte), 1, file) != 1 ||
+       fwrite(&grid->x, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->y, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->max_iterations, sizeof(byte), 1, file) != 1 ||
+       fwrite(&precision, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->lower_left, sizeof(complex_t), 1, file) != 1 ||
+       fwrite(&grid->upper_right, sizeof(complex_t), 1, file) != 1 ||
+       fwrite(&header.chunk_width, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&header.chunk_height, sizeof(size_t), 1, file) != 1 ||
+       fwrite(index, sizeof(grid_chunk), chunks, file) != chunks){
+        status = GRID_WRITE_ERROR;
+    }
+
+    for(size_t i = 0; status == 0 && i < chunks; i++){
+        const byte* stored = coded[i];
+        if(!stored){
+            size_t x, y, width, height;
+            chunk_rect(&header, i, &x, &y, &width, &height);
+            for(size_t row = 0; row < height; row++){
+                memcpy(buffer + row * width, grid->data + (y + row) * grid->x + x, width);
+            }
+            stored = buffer;
+        }
+        if(fwrite(stored, 1, index[i].size, file) != index[i].size){
+            status = GRID_WRITE_ERROR;
+        }
+    }
+
+    for(size_t i = 0; i < chunks; i++){
+        free(coded[i]);
+    }
+    free(coded);
+    free(buffer);
+    free(index);
+    return status;
+}
+
+/*
+ * Creates a grid from a rectangular region of a .grid file, the region starts at point (x, y) of the grid in the file
+ * The corners of the new grid are the complex numbers of the region, so its points are the same points as in the file
+ *
+ * For chunked grids only the chunks that overlap the region are read, for flat grids only the rows of the region are read
+ * The file must be seekable
+ */
+grid_t* read_grid_region(FILE* restrict file, const size_t x, const size_t y, const size_t width, const size_t height){
+    const long start = ftell(file);
+    grid_header header;
+    if(start < 0 || !read_grid_header(file, &header)) return NULL;
+
+    if(width == 0 || height == 0 || x >= header.x || y >= header.y || width > header.x - x || height > header.y - y){
+        fprintf(stderr, "Region %zux%zu at (%zu, %zu) is not inside the %zux%zu grid\n", width, height, x, y, header.x, header.y);
+        return NULL;
+    }
+
+#ifdef DOUBLE_DOUBLE_PRECISION
+    const double_double x_min = dd_real(header.lower_left);
+    const double_double y_min = dd_imag(header.lower_left);
+    const CBASE x_step = dd_sub(dd_real(header.upper_right), x_min).hi / (double)header.x;
+    const CBASE y_step = dd_sub(dd_imag(header.upper_right), y_min).hi / (double)header.y;
+    const complex_t lower_left = dd_complex(dd_add(x_min, two_prod(x, x_step)), dd_add(y_min, two_prod(y, y_step)));
+    const complex_t upper_right = dd_complex(dd_add(x_min, two_prod(x + width, x_step)), dd_add(y_min, two_prod(y + height, y_step)));
+#else
+    const CBASE x_step = (header.upper_right.re - header.lower_left.re) / (double)header.x;
+    const CBASE y_step = (header.upper_right.im - header.lower_left.im) / (double)header.y;
+    const complex_t lower_left = {
+        .re = header.lower_left.re + x * x_step,
+        .im = header.lower_left.im + y * y_step
+    };
+    const complex_t upper_right = {
+        .re = header.lower_left.re + (x + width) * x_step,
+        .im = header.lower_left.im + (y + height) * y_step
+    };
+#endif
+    grid_t* grid = create_grid(width, height, header.max_iterations, lower_left, upper_right);
+    if(!grid) return NULL;
+
+    bool success = true;
+    if(header.version == GRID_VERSION_FLAT){
+        const long data_start = start + GRID_HEADER_SIZE;
+        for(size_t row = 0; success && row < height; row++){
+            success = fseek(file, data_start + (y + row) * header.x + x, SEEK_SET) == 0 &&
+                fread(grid->data + row * width, 1, width, file) == width;
+        }
+        if(!success) perror("Error reading region");
+    }
+    else {
+        grid_chunk* index = read_chunk_index(file, &header);
+        byte* buffer = malloc(header.chunk_width * header.chunk_height);
+        byte* scratch = malloc(header.chunk_width * header.chunk_height);
+        success = index && buffer && scratch;
+
+        const size_t columns = chunk_columns(&header);
+        const size_t first_column = x / header.chunk_width;
+        const size_t last_column = (x + width - 1) / header.chunk_width;
+        const size_t first_row = y / header.chunk_height;
+        const size_t last_row = (y + height - 1) / header.chunk_height;
+        for(size_t chunk_row = first_row; success && chunk_row <= last_row; chunk_row++){
+            for(size_t chunk_column = first_column; success && chunk_column <= last_column; chunk_column++){
+                const size_t chunk = chunk_row * columns + chunk_column;
+                size_t chunk_x, chunk_y, chunk_width, chunk_height;
+                chunk_rect(&header, chunk, &chunk_x, &chunk_y, &chunk_width, &chunk_height);
+
+                success = fseek(file, start + index[chunk].offset, SEEK_SET) == 0 &&
+                    read_chunk(file, index[chunk], buffer, scratch, chunk_width * chunk_height);
+
+                // the part of the chunk inside the region
+                const size_t left = x > chunk_x ? x : chunk_x;
+                const size_t right = x + width < chunk_x + chunk_width ? x + width : chunk_x + chunk_width;
+                const size_t bottom = y > chunk_y ? y : chunk_y;
+                const size_t top = y + height < chunk_y + chunk_height ? y + height : chunk_y + chunk_height;
+                for(size_t row = bottom; success && row < top; row++){
+                    memcpy(grid->data + (row - y) * width + (left - x), buffer + (row - chunk_y) * chunk_width + (left - chunk_x), right - left);
+                }
+            }
+        }
+        free(scratch);
+        free(buffer);
+        free(index);
+    }
+
+    if(!success){
+        free_grid(grid);
+        return NULL;
+    }
+    return grid;
+}
+
+/*
+ * Reads the version of the .grid file, then returns to where the file was
+ * Returns 0 if the file is not a valid grid
+ */
+int grid_file_version(FILE* restrict file){
+    const long start = ftell(file);
+    grid_header header;
+    const int version = start >= 0 && read_grid_header(file, &header) ? header.version : 0;
+    fseek(file, start, SEEK_SET);
+    return version;
+}
+
+/*
+ * Fills in a .grid header at the start of a mapping
+ */
+static void store_grid_header(byte* header, const grid_t* grid){
+    const byte magic_num[3] = { 0xA6, 0x00, 0x5E };
+    const size_t precision = GRID_PRECISION;
+
+    memcpy(header, magic_num, 3);
+    header += 3;
+    memcpy(header, &grid->x, sizeof(size_t));
+    header += sizeof(size_t);
+    memcpy(header, &grid->y, sizeof(size_t));
+    header += sizeof(size_t);
+    *header++ = grid->max_iterations;
+    memcpy(header, &precision, sizeof(size_t));
+    header += sizeof(size_t);
+    memcpy(header, &grid->lower_left, sizeof(complex_t));
+    header += sizeof(complex_t);
+    memcpy(header, &grid->upper_right, sizeof(complex_t));
+}
+
+/*
+ * Creates a grid from a .grid file whose data is memory mapped instead of read
+ * The pages of the file are only read once they are used, writes to the data are private to the process and are not saved
+ *
+ * The grid must be released with unmap_grid
+ */
+grid_t* map_grid(const char* filename){
+    const int fd = open(filename, O_RDONLY);
+    if(fd < 0){
+        perror("Error opening file");
+        return NULL;
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0){
+        perror("Error reading file");
+        close(fd);
+        return NULL;
+    }
+    const size_t file_size = file_stat.st_size;
+    if(file_size < GRID_HEADER_SIZE){
+        fprintf(stderr, "Error reading file, %s is too small to be a grid\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    byte* mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        perror("Error mapping file");
+        return NULL;
+    }
+
+    const byte* header = mapping;
+    if(header[0] != 0xA6 || header[1] != 0x00 || header[2] != 0x5E){
+        fprintf(stderr, "Error reading file, can't find magic number 0xA6005E\n");
+        munmap(mapping, file_size);
+        return NULL;
+    }
+    header += 3;
+
+    size_t x = 0;
+    memcpy(&x, header, sizeof(size_t));
+    if(x == 0){
+        fprintf(stderr, "Error mapping file, only flat grids can be mapped, %s is chunked\n", filename);
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    size_t y = 0;
+    size_t precision = 0;
+    complex_t lower_left, upper_right;
+    header += sizeof(size_t);
+    memcpy(&y, header, sizeof(size_t));
+    header += sizeof(size_t);
+    const byte max_iterations = *header++;
+    memcpy(&precision, header, sizeof(size_t));
+    header += sizeof(size_t);
+    memcpy(&lower_left, header, sizeof(complex_t));
+    header += sizeof(complex_t);
+    memcpy(&upper_right, header, sizeof(complex_t));
+
+    // the header is checked against the size of the file before anything relies on it
+    if(precision != GRID_PRECISION){
+        fprintf(stderr, "File's precisions does not match programs: %zu != %zu\n", precision, GRID_PRECISION);
+        munmap(mapping, file_size);
+        return NULL;
+    }
+    const size_t points = file_size - GRID_HEADER_SIZE;
+    // x * y could overflow, so the points are divided instead
+    if(y == 0 || x > points / y){
+        fprintf(stderr, "Error reading file, the %zux%zu grid does not fit the %zu grid points found\n", x, y, points);
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    grid_t* grid = malloc(sizeof(grid_t));
+    if(!grid){
+        fprintf(stderr, "Error allocating grid\n");
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    *grid = (grid_t){
+        .x = x,
+        .y = y,
+        .size = x * y,
+        .max_iterations = max_iterations,
+        .lower_left = lower_left,
+        .upper_right = upper_right,
+        .data = mapping + GRID_HEADER_SIZE,
+        .mapped_size = file_size
+    };
 
     return grid;
 }
+
+/*
+ * Creates a .grid file sized for a grid and maps it, so the grid can be filled in place without a call to write_grid
+ * The header is written when the grid is created, the data is saved to the file as it is filled
+ * Only regular files can be mapped, returns NULL for other files or if the space of the file could not be reserved
+ *
+ * The grid must be released with unmap_grid
+ */
+grid_t* create_mapped_grid(const char* filename, const size_t x, const size_t y, const byte max_iterations, complex_t lower_left, complex_t upper_right){
+    if(x <= 0 || y <= 0) return NULL;
+
+    const size_t size = x * y;
+    const size_t file_size = GRID_HEADER_SIZE + size;
+    const int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if(fd < 0){
+        perror("Error creating file");
+        return NULL;
+    }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)){
+        fprintf(stderr, "Error mapping file, %s is not a regular file\n", filename);
+        close(fd);
+        return NULL;
+    }
+    if(ftruncate(fd, 0) != 0){
+        perror("Error truncating file");
+        close(fd);
+        return NULL;
+    }
+    // the blocks of the file are reserved up front, running out of space while the mapping is filled would raise SIGBUS
+    const int status = posix_fallocate(fd, 0, file_size);
+    if(status != 0){
+        fprintf(stderr, "Error reserving %zu bytes for %s: %s\n", file_size, filename, strerror(status));
+        close(fd);
+        return NULL;
+    }
+
+    byte* mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        perror("Error mapping file");
+        return NULL;
+    }
+
+    grid_t* grid = malloc(sizeof(grid_t));
+    if(!grid){
+        fprintf(stderr, "Error allocating grid\n");
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    *grid = (grid_t){
+        .x = x,
+        .y = y,
+        .size = size,
+        .max_iterations = max_iterations,
+        .lower_left = lower_left,
+        .upper_right = upper_right,
+        .data = mapping + GRID_HEADER_SIZE,
+        .mapped_size = file_size
+    };
+    store_grid_header(mapping, grid);
+
+    return grid;
+}
+
+/*
+ * Unmaps a grid created by map_grid or create_mapped_grid and frees it
+ */
+void unmap_grid(grid_t* grid){
+    if(!grid) return;
+
+    munmap(grid->data - GRID_HEADER_SIZE, grid->mapped_size);
+    free(grid);
+}
+
+/*
+ * Counts the points of a grid with every iteration count
+ * The rows are counted in parallel into histograms local to each thread, which are merged at the end
+ */
+void grid_histogram(const grid_t* grid, size_t histogram[256]){
+    memset(histogram, 0, 256 * sizeof(size_t));
+
+    #pragma omp parallel default(none) shared(grid, histogram)
+    {
+        size_t counts[HISTOGRAM_LANES][256] = { 0 };
+
+        #pragma omp for schedule(static)
+        for(size_t y = 0; y < grid->y; y++){
+            count_iterations(counts, grid->data + y * grid->x, grid->x);
+        }
+
+        #pragma omp critical
+        merge_histogram_lanes(histogram, counts);
+    }
+}
+
+/*
+ * Writes the histogram of a grid, see grid_histogram, so a renderer can color the grid without counting its points again
+ * Returns 0 on success
+ *
+ * The first 3 bytes of the file are the magic number
+ * The next 16 bytes are the dimensions of the grid, x then y
+ * The next 1 byte is the max_iterations of the grid
+ * The rest of the file is the number of points with each iteration count from 0 to 255
+ */
+int write_histogram(FILE* restrict file, const grid_t* grid, const size_t histogram[256]){
+    const unsigned char magic_num[3] = { 0xA6, 0x00, 0x5D };
+    if(fwrite(magic_num, 1, 3, file) != 3 ||
+       fwrite(&grid->x, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->y, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->max_iterations, sizeof(byte), 1, file) != 1 ||
+       fwrite(histogram, sizeof(size_t), 256, file) != 256){
+        return GRID_WRITE_ERROR;
+    }
+    return 0;
+}
+
+/*
+ * Reads a histogram written by write_histogram
+ * Returns false if the file is not a histogram or it was not counted from a grid like grid
+ */
+bool read_histogram(FILE* restrict file, const grid_t* grid, size_t histogram[256]){
+    unsigned char magic_num[3];
+    size_t x, y;
+    byte max_iterations;
+    if(fread(magic_num, 1, 3, file) != 3 ||
+       (size_t)(magic_num[0] << 16 | magic_num[1] << 8 | magic_num[2]) != HISTOGRAM_MAGIC_NUMBER ||
+       fread(&x, sizeof(size_t), 1, file) != 1 ||
+       fread(&y, sizeof(size_t), 1, file) != 1 ||
+       fread(&max_iterations, sizeof(byte), 1, file) != 1 ||
+       fread(histogram, sizeof(size_t), 256, file) != 256){
+        fprintf(stderr, "Error reading histogram, the file is not a histogram\n");
+        return false;
+    }
+
+    size_t points = 0;
+    for(size_t i = 0; i < 256; i++){
+        points += histogram[i];
+    }
+    if(x != grid->x || y != grid->y || max_iterations != grid->max_iterations || points != grid->size){
+        fprintf(stderr, "Error reading histogram, it was counted from a %zux%zu grid of %hhu iterations\n", x, y, max_iterations);
+        return false;
+    }
+    return true;
+}
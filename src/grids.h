@@ -13,13 +13,59 @@
 #define GRID_WRITE_ERROR 2
 
 #define GRID_MAGIC_NUMBER 0xA6005E
+#define HISTOGRAM_MAGIC_NUMBER 0xA6005D
+
+// versions of the .grid format
+#define GRID_VERSION_FLAT 1
+#define GRID_VERSION_CHUNKED 2
+
+// the dimensions of the chunks in the chunked .grid format
+#ifndef GRID_CHUNK_WIDTH
+#define GRID_CHUNK_WIDTH 256
+#endif
+#ifndef GRID_CHUNK_HEIGHT
+#define GRID_CHUNK_HEIGHT 256
+#endif
+
+// the size of the flat .grid header that comes before the data, see write_grid
+#define GRID_HEADER_SIZE (3 + 3 * sizeof(size_t) + sizeof(byte) + 2 * sizeof(complex_t))
 
 // hack to allow variable precision at compile time
 typedef struct {
     CBASE re;
     CBASE im;
+#ifdef DOUBLE_DOUBLE_PRECISION
+    // the low parts of re and im as double-doubles, the full real component is re + re_lo
+    CBASE re_lo;
+    CBASE im_lo;
+#endif
 } complex_t;
 
+// the precision stored in a .grid header, the size of complex_t except for double-double grids,
+// whose complex_t has the same size as the long double one
+#define GRID_PRECISION_DOUBLE_DOUBLE 0x100
+#ifdef DOUBLE_DOUBLE_PRECISION
+#define GRID_PRECISION (GRID_PRECISION_DOUBLE_DOUBLE | sizeof(complex_t))
+#else
+#define GRID_PRECISION sizeof(complex_t)
+#endif
+
+#ifdef DOUBLE_DOUBLE_PRECISION
+#include "double_double.h"
+
+static inline double_double dd_real(const complex_t z){
+    return (double_double){ z.re, z.re_lo };
+}
+
+static inline double_double dd_imag(const complex_t z){
+    return (double_double){ z.im, z.im_lo };
+}
+
+static inline complex_t dd_complex(const double_double re, const double_double im){
+    return (complex_t){ .re = re.hi, .im = im.hi, .re_lo = re.lo, .im_lo = im.lo };
+}
+#endif
+
 // I've gone back and forth on the size for a grid point, eventually I settled on a byte
 // ideally it should just be its own type which can be configured similarly to precision.h
 // but it does not seem worth
@@ -33,8 +79,37 @@ typedef struct {
     complex_t lower_left;
     complex_t upper_right;
     byte* data;
+    // the length of the file mapping of a grid from map_grid or create_mapped_grid, 0 for grids that are not mapped
+    size_t mapped_size;
 } grid_t;
 
+// the histograms the iterations of a thread are counted into, a run of equal iterations is spread over them
+// so its increments do not have to wait on each other
+#define HISTOGRAM_LANES 4
+
+/*
+ * Adds the iterations of size points to the histograms of a thread, which are summed by merge_histogram_lanes
+ */
+static inline void count_iterations(size_t counts[HISTOGRAM_LANES][256], const byte* data, const size_t size){
+    size_t i = 0;
+    for(; i + HISTOGRAM_LANES <= size; i += HISTOGRAM_LANES){
+        for(size_t lane = 0; lane < HISTOGRAM_LANES; lane++){
+            counts[lane][data[i + lane]]++;
+        }
+    }
+    for(; i < size; i++){
+        counts[0][data[i]]++;
+    }
+}
+
+static inline void merge_histogram_lanes(size_t histogram[256], size_t counts[HISTOGRAM_LANES][256]){
+    for(size_t lane = 0; lane < HISTOGRAM_LANES; lane++){
+        for(size_t i = 0; i < 256; i++){
+            histogram[i] += counts[lane][i];
+        }
+    }
+}
+
 grid_t* create_grid(const size_t x, const size_t y, const byte max_iterations, complex_t lower_left, complex_t upper_right);
 void set_grid(grid_t* grid, const byte val);
 grid_t* copy_grid(const grid_t* grid);
@@ -53,3 +128,12 @@ void print_grid_info(const grid_t* grid);
 void print_grid(FILE* file, const grid_t* grid);
 int write_grid(FILE* file, const grid_t* grid);
 grid_t* read_grid(FILE* file);
+int write_chunked_grid(FILE* file, const grid_t* grid, const bool compress);
+grid_t* read_grid_region(FILE* file, const size_t x, const size_t y, const size_t width, const size_t height);
+int grid_file_version(FILE* file);
+grid_t* map_grid(const char* filename);
+grid_t* create_mapped_grid(const char* filename, const size_t x, const size_t y, const byte max_iterations, complex_t lower_left, complex_t upper_right);
+void unmap_grid(grid_t* grid);
+void grid_histogram(const grid_t* grid, size_t histogram[256]);
+int write_histogram(FILE* file, const grid_t* grid, const size_t histogram[256]);
+bool read_histogram(FILE* file, const grid_t* grid, size_t histogram[256]);
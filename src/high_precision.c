@@ -0,0 +1,197 @@
+/*
+ * Fixed point arithmetic on hp_real, see high_precision.h
+ *
+ * Only the operations needed to iterate a reference orbit are provided, results are truncated
+ * to the precision of the fraction and overflow of the integer part is not checked
+ */
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include "high_precision.h"
+
+// the number of bits in the fraction
+#define FRACTION_BITS (64 * (HP_LIMBS - 1))
+
+static inline bool is_negative(const hp_real a){
+    return a.limb[HP_LIMBS - 1] >> 63;
+}
+
+static inline hp_real negate(const hp_real a){
+    hp_real result;
+    unsigned __int128 carry = 1;
+    for(int i = 0; i < HP_LIMBS; i++){
+        carry += ~a.limb[i];
+        result.limb[i] = carry;
+        carry >>= 64;
+    }
+    return result;
+}
+
+static inline hp_real magnitude(const hp_real a){
+    return is_negative(a) ? negate(a) : a;
+}
+
+/*
+ * Multiplies the magnitude of a number by a small integer
+ */
+static hp_real multiply_small(const hp_real a, const uint64_t factor){
+    hp_real result;
+    unsigned __int128 carry = 0;
+    for(int i = 0; i < HP_LIMBS; i++){
+        carry += (unsigned __int128)a.limb[i] * factor;
+        result.limb[i] = carry;
+        carry >>= 64;
+    }
+    return result;
+}
+
+/*
+ * Divides the magnitude of a number by a small integer, rounding towards 0
+ */
+static hp_real divide_small(const hp_real a, const uint64_t divisor){
+    hp_real result;
+    unsigned __int128 remainder = 0;
+    for(int i = HP_LIMBS - 1; i >= 0; i--){
+        remainder = remainder << 64 | a.limb[i];
+        result.limb[i] = remainder / divisor;
+        remainder %= divisor;
+    }
+    return result;
+}
+
+/*
+ * Converts a double to a fixed point number, exactly for doubles with a magnitude below 2^63
+ */
+hp_real hp_from_double(const double value){
+    hp_real result = {{0}};
+    double remaining = fabs(value);
+    result.limb[HP_LIMBS - 1] = remaining;
+    remaining -= result.limb[HP_LIMBS - 1];
+    for(int i = HP_LIMBS - 2; i >= 0 && remaining != 0; i--){
+        remaining = ldexp(remaining, 64);
+        result.limb[i] = remaining;
+        remaining -= result.limb[i];
+    }
+    return value < 0 ? negate(result) : result;
+}
+
+/*
+ * Rounds a fixed point number to the nearest double
+ */
+double hp_to_double(const hp_real a){
+    const hp_real abs_a = magnitude(a);
+    double result = 0;
+    for(int i = 0; i < HP_LIMBS; i++){
+        result += ldexp(abs_a.limb[i], 64 * i - FRACTION_BITS);
+    }
+    return is_negative(a) ? -result : result;
+}
+
+hp_real hp_add(const hp_real a, const hp_real b){
+    hp_real result;
+    unsigned __int128 carry = 0;
+    for(int i = 0; i < HP_LIMBS; i++){
+        carry += (unsigned __int128)a.limb[i] + b.limb[i];
+        result.limb[i] = carry;
+        carry >>= 64;
+    }
+    return result;
+}
+
+hp_real hp_sub(const hp_real a, const hp_real b){
+    return hp_add(a, negate(b));
+}
+
+/*
+ * Multiplies two fixed point numbers, the product is truncated to the precision of the fraction
+ */
+hp_real hp_mul(const hp_real a, const hp_real b){
+    const hp_real abs_a = magnitude(a);
+    const hp_real abs_b = magnitude(b);
+
+    uint64_t product[2 * HP_LIMBS] = {0};
+    for(int i = 0; i < HP_LIMBS; i++){
+        unsigned __int128 carry = 0;
+        for(int j = 0; j < HP_LIMBS; j++){
+            carry += (unsigned __int128)abs_a.limb[i] * abs_b.limb[j] + product[i + j];
+            product[i + j] = carry;
+            carry >>= 64;
+        }
+        product[i + HP_LIMBS] = carry;
+    }
+
+    // the product has twice the fraction bits, drop the least significant limbs
+    hp_real result;
+    for(int i = 0; i < HP_LIMBS; i++){
+        result.limb[i] = product[i + HP_LIMBS - 1];
+    }
+    return is_negative(a) != is_negative(b) ? negate(result) : result;
+}
+
+hp_real hp_half(const hp_real a){
+    hp_real result;
+    for(int i = 0; i < HP_LIMBS - 1; i++){
+        result.limb[i] = a.limb[i] >> 1 | a.limb[i + 1] << 63;
+    }
+    result.limb[HP_LIMBS - 1] = (uint64_t)((int64_t)a.limb[HP_LIMBS - 1] >> 1);
+    return result;
+}
+
+/*
+ * Parses a decimal number such as -0.7436438870371587047521915061147745e-2 without losing its digits to a double
+ * If end is not NULL it is set to the first character after the number
+ *
+ * Returns false if there is no number at the start of string
+ */
+bool hp_parse(const char* string, hp_real* value, const char** end){
+    const char* p = string;
+    const bool negative = *p == '-';
+    if(*p == '-' || *p == '+') p++;
+
+    if(!isdigit((unsigned char)*p) && !(*p == '.' && isdigit((unsigned char)p[1]))) return false;
+
+    hp_real result = {{0}};
+    for(; isdigit((unsigned char)*p); p++){
+        result = multiply_small(result, 10);
+        result.limb[HP_LIMBS - 1] += *p - '0';
+    }
+
+    // the fraction is accumulated from its last digit, dividing by 10 before each more significant digit
+    if(*p == '.'){
+        const char* first = ++p;
+        while(isdigit((unsigned char)*p)) p++;
+        hp_real fraction = {{0}};
+        for(const char* digit = p - 1; digit >= first; digit--){
+            fraction.limb[HP_LIMBS - 1] = *digit - '0';
+            fraction = divide_small(fraction, 10);
+        }
+        result = hp_add(result, fraction);
+    }
+
+    if((*p == 'e' || *p == 'E') && (isdigit((unsigned char)p[1]) || ((p[1] == '-' || p[1] == '+') && isdigit((unsigned char)p[2])))){
+        char* exponent_end;
+        const long exponent = strtol(p + 1, &exponent_end, 10);
+        p = exponent_end;
+        for(long i = 0; i < labs(exponent); i++){
+            result = exponent > 0 ? multiply_small(result, 10) : divide_small(result, 10);
+        }
+    }
+
+    if(end) *end = p;
+    *value = negative ? negate(result) : result;
+    return true;
+}
+
+/*
+ * Parses a complex number in the same re+imi form as the other complex arguments, such as -0.75+0.1i or -0.75-0.1i
+ *
+ * Returns false if the string is not a complex number
+ */
+bool hp_parse_complex(const char* string, hp_real* re, hp_real* im){
+    const char* p;
+    if(!hp_parse(string, re, &p)) return false;
+    if(*p == '+' && (p[1] == '-' || p[1] == '+')) p++;
+    if(*p != '+' && *p != '-') return false;
+    if(!hp_parse(p, im, &p)) return false;
+    return p[0] == 'i' && p[1] == '\0';
+}
@@ -0,0 +1,36 @@
+/*
+ * Fixed point real numbers with more precision than a long double, for points that have to be known
+ * beyond the precision of the grid, like the center of a deep zoom
+ *
+ * A number is a two's complement integer of HP_LIMBS 64 bit limbs, scaled so the most significant limb
+ * holds the integer part and the others the fraction. With the default of 4 limbs the fraction has 192 bits,
+ * enough for views around 1e-50 wide
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef HP_LIMBS
+#define HP_LIMBS 4
+#endif
+
+// limbs are stored least significant first, limb[HP_LIMBS - 1] is the signed integer part
+typedef struct {
+    uint64_t limb[HP_LIMBS];
+} hp_real;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+hp_real hp_from_double(const double value);
+double hp_to_double(const hp_real a);
+hp_real hp_add(const hp_real a, const hp_real b);
+hp_real hp_sub(const hp_real a, const hp_real b);
+hp_real hp_mul(const hp_real a, const hp_real b);
+hp_real hp_half(const hp_real a);
+bool hp_parse(const char* string, hp_real* value, const char** end);
+bool hp_parse_complex(const char* string, hp_real* re, hp_real* im);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Saving and reading the iteration state of a grid, see iteration_state.h
+ *
+ * A state file starts with the magic number, the dimensions, iterations and corners of its grid and the state_origin,
+ * followed by the number of saved points and a saved_point for each of them
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "iteration_state.h"
+
+// the saved points are read and written this many at a time
+#define STATE_IO_POINTS 4096
+
+// a point as it is saved in a state file
+typedef struct {
+    size_t index;
+    CBASE re;
+    CBASE im;
+} saved_point;
+
+/*
+ * Allocates the state of every point of a grid, the points start at z = 0 until a kernel saves them
+ * Returns NULL if the state could not be allocated
+ */
+static iteration_state* allocate_state(const size_t x, const size_t y){
+    iteration_state* state = malloc(sizeof(iteration_state));
+    CBASE* re = calloc(x * y, sizeof(CBASE));
+    CBASE* im = calloc(x * y, sizeof(CBASE));
+    if(!state || !re || !im){
+        fprintf(stderr, "Error allocating the iteration state of a %zux%zu grid\n", x, y);
+        free(state); free(re); free(im);
+        return NULL;
+    }
+    *state = (iteration_state){ .x = x, .y = y, .re = re, .im = im };
+    return state;
+}
+
+/*
+ * Creates the state a grid saves its points to while it is generated from scratch
+ * Returns NULL if the state could not be allocated
+ */
+iteration_state* create_iteration_state(const grid_t* grid, const state_origin origin){
+    iteration_state* state = allocate_state(grid->x, grid->y);
+    if(!state) return NULL;
+
+    state->origin = origin;
+    state->iterations = grid->max_iterations;
+    state->resume = false;
+    state->lower_left = grid->lower_left;
+    state->upper_right = grid->upper_right;
+    state->data = grid->data;
+    return state;
+}
+
+void free_iteration_state(iteration_state* state){
+    if(!state) return;
+    free(state->re);
+    free(state->im);
+    free(state);
+}
+
+/*
+ * Writes the state of the points of a generated grid that have not escaped
+ * Returns 0 on success, or STATE_WRITE_ERROR
+ */
+int write_iteration_state(FILE* file, const iteration_state* state, const grid_t* grid){
+    const unsigned char magic_num[3] = { 0xA6, 0x00, 0x5F };
+    size_t saved = 0;
+    for(size_t i = 0; i < grid->size; i++){
+        saved += grid->data[i] == grid->max_iterations;
+    }
+
+    if(fwrite(magic_num, 1, 3, file) != 3 ||
+       fwrite(&grid->x, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->y, sizeof(size_t), 1, file) != 1 ||
+       fwrite(&grid->max_iterations, sizeof(byte), 1, file) != 1 ||
+       fwrite(&grid->lower_left, sizeof(complex_t), 1, file) != 1 ||
+       fwrite(&grid->upper_right, sizeof(complex_t), 1, file) != 1 ||
+       fwrite(&state->origin, sizeof(state_origin), 1, file) != 1 ||
+       fwrite(&saved, sizeof(size_t), 1, file) != 1){
+        return STATE_WRITE_ERROR;
+    }
+
+    saved_point points[STATE_IO_POINTS];
+    size_t buffered = 0;
+    for(size_t i = 0; i < grid->size; i++){
+        if(grid->data[i] != grid->max_iterations) continue;
+        points[buffered++] = (saved_point){ .index = i, .re = state->re[i], .im = state->im[i] };
+        if(buffered == STATE_IO_POINTS){
+            if(fwrite(points, sizeof(saved_point), buffered, file) != buffered) return STATE_WRITE_ERROR;
+            buffered = 0;
+        }
+    }
+    if(buffered && fwrite(points, sizeof(saved_point), buffered, file) != buffered) return STATE_WRITE_ERROR;
+    return 0;
+}
+
+/*
+ * Reads a state written by write_iteration_state, ready to resume the points it saved
+ * The data of the grid it is resumed into still has to be set
+ *
+ * Returns NULL if the file is not a state file or could not be read
+ */
+iteration_state* read_iteration_state(FILE* file){
+    unsigned char magic_num[3];
+    if(fread(magic_num, 1, 3, file) != 3 ||
+       (size_t)(magic_num[0] << 16 | magic_num[1] << 8 | magic_num[2]) != STATE_MAGIC_NUMBER){
+        fprintf(stderr, "Error reading state, the file is not an iteration state\n");
+        return NULL;
+    }
+
+    size_t x, y, saved;
+    byte iterations;
+    complex_t lower_left, upper_right;
+    state_origin origin;
+    if(fread(&x, sizeof(size_t), 1, file) != 1 ||
+       fread(&y, sizeof(size_t), 1, file) != 1 ||
+       fread(&iterations, sizeof(byte), 1, file) != 1 ||
+       fread(&lower_left, sizeof(complex_t), 1, file) != 1 ||
+       fread(&upper_right, sizeof(complex_t), 1, file) != 1 ||
+       fread(&origin, sizeof(state_origin), 1, file) != 1 ||
+       fread(&saved, sizeof(size_t), 1, file) != 1){
+        fprintf(stderr, "Error reading state, the header is incomplete\n");
+        return NULL;
+    }
+    origin.fractal[STATE_FRACTAL_SIZE - 1] = '\0';
+
+    iteration_state* state = allocate_state(x, y);
+    if(!state) return NULL;
+    state->origin = origin;
+    state->iterations = iterations;
+    state->resume = true;
+    state->lower_left = lower_left;
+    state->upper_right = upper_right;
+
+    saved_point points[STATE_IO_POINTS];
+    for(size_t i = 0; i < saved; i += STATE_IO_POINTS){
+        const size_t count = saved - i < STATE_IO_POINTS ? saved - i : STATE_IO_POINTS;
+        const size_t read_count = fread(points, sizeof(saved_point), count, file);
+        if(read_count != count){
+            fprintf(stderr, "Error reading state, expected %zu saved points but only found %zu\n", saved, i + read_count);
+            free_iteration_state(state);
+            return NULL;
+        }
+        for(size_t j = 0; j < count; j++){
+            if(points[j].index >= x * y){
+                fprintf(stderr, "Error reading state, saved point %zu lies outside the %zux%zu grid\n", points[j].index, x, y);
+                free_iteration_state(state);
+                return NULL;
+            }
+            state->re[points[j].index] = points[j].re;
+            state->im[points[j].index] = points[j].im;
+        }
+    }
+    return state;
+}
+
+/*
+ * Checks if a state was saved from a grid, iterated with the same fractal, parameters and flags
+ */
+bool state_matches(const iteration_state* state, const grid_t* grid, const state_origin origin){
+    const state_origin saved = state->origin;
+    return state->x == grid->x && state->y == grid->y && state->iterations == grid->max_iterations &&
+        state->lower_left.re == grid->lower_left.re && state->lower_left.im == grid->lower_left.im &&
+        state->upper_right.re == grid->upper_right.re && state->upper_right.im == grid->upper_right.im &&
+        strncmp(saved.fractal, origin.fractal, STATE_FRACTAL_SIZE) == 0 && saved.flags == origin.flags &&
+        saved.degree == origin.degree && saved.constant.re == origin.constant.re && saved.constant.im == origin.constant.im &&
+        saved.radius == origin.radius;
+}
@@ -0,0 +1,54 @@
+/*
+ * Iteration state of the points of a grid, which lets a grid be iterated further without starting over
+ *
+ * While a grid with a state is generated the kernels save the z every point ended on. A state file holds the z of
+ * the points that had not escaped, so a grid read back with its state can be continued to a higher max_iterations,
+ * iterating only the points that are still bounded. The result is identical to generating the grid at the higher limit
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "grids.h"
+#include "precision.h"
+
+#define STATE_MAGIC_NUMBER 0xA6005F
+
+// state read and write errors
+#define STATE_WRITE_ERROR 2
+
+// the longest fractal name a state records
+#define STATE_FRACTAL_SIZE 32
+
+// what the points of a state were iterated with, a state can only be continued with the same
+typedef struct {
+    char fractal[STATE_FRACTAL_SIZE];
+    unsigned int flags;
+    CBASE degree;
+    complex_t constant;
+    double radius;
+} state_origin;
+
+typedef struct {
+    state_origin origin;
+    // the iterations the points have been iterated to, the max_iterations of the grid they were saved from
+    byte iterations;
+    // continue the points that have not escaped from their saved z instead of starting over
+    bool resume;
+    size_t x;
+    size_t y;
+    complex_t lower_left;
+    complex_t upper_right;
+    // the data of the grid being generated, kernels find the index of a point from its offset into it
+    const byte* data;
+    // the real and imaginary part of the z of every point
+    CBASE* re;
+    CBASE* im;
+} iteration_state;
+
+iteration_state* create_iteration_state(const grid_t* grid, const state_origin origin);
+void free_iteration_state(iteration_state* state);
+int write_iteration_state(FILE* file, const iteration_state* state, const grid_t* grid);
+iteration_state* read_iteration_state(FILE* file);
+bool state_matches(const iteration_state* state, const grid_t* grid, const state_origin origin);
@@ -0,0 +1,339 @@
+/*
+ * Perturbation iteration around high precision reference orbits, see perturbation.h
+ *
+ * For a reference point C with orbit X and a point c = C + dc with orbit x = X + d,
+ * x' = x^p + c becomes d' = (X + d)^p - X^p + dc, which only involves differences small enough for a double
+ *
+ * The series approximation writes d after n iterations as a_1 u + a_2 u^2 + ... with u = dc / r for the largest
+ * offset r in the view, so |u| <= 1 and the coefficients stay in the range of a double. Substituting the series into
+ * the iteration of d gives the iteration of the coefficients, which only depends on the reference orbit
+ */
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perturbation.h"
+
+struct perturbation_state {
+    grid_t* grid;
+    int degree;
+    bool conjugate;
+    perturbation_view view;
+    // the binomial coefficients of the degree, for expanding (X + d)^degree
+    double binomial[MAX_PERTURBATION_DEGREE + 1];
+
+    // the reference orbit after k iterations is orbit_re[k] + orbit_im[k] i, stopping after it escapes
+    double* orbit_re;
+    double* orbit_im;
+    size_t orbit_length;
+    // the reference point relative to the center of the view
+    double reference_re;
+    double reference_im;
+    size_t references;
+
+    // the series approximation of the current reference, points start at iteration series_skip
+    // series[k] is the coefficient of u^(k + 1), with u the offset of a point divided by series_radius
+    double complex series[SERIES_TERMS];
+    double series_radius;
+    size_t series_skip;
+    size_t first_series_skip;
+
+    // points that still have to be iterated against the current reference
+    byte* pending;
+    const grid_gen_params* params;
+};
+
+/*
+ * Raises a high precision complex number to a positive integer power by repeated multiplication
+ */
+static void hp_complex_power(hp_real* re, hp_real* im, const hp_real x, const hp_real y, const int degree){
+    hp_real power_re = x;
+    hp_real power_im = y;
+    for(int i = 1; i < degree; i++){
+        const hp_real next_re = hp_sub(hp_mul(power_re, x), hp_mul(power_im, y));
+        power_im = hp_add(hp_mul(power_re, y), hp_mul(power_im, x));
+        power_re = next_re;
+    }
+    *re = power_re;
+    *im = power_im;
+}
+
+/*
+ * Iterates the coefficients of the series approximation one step along the reference orbit at X
+ * The powers of the series are truncated to SERIES_TERMS terms, so terms of d^k only appear for k <= SERIES_TERMS
+ */
+static void step_series(const perturbation_state* state, const double complex X, const double complex* series, double complex* next){
+    double complex power[SERIES_TERMS];
+    double complex X_power[MAX_PERTURBATION_DEGREE + 1];
+    X_power[0] = 1;
+    for(int k = 1; k <= state->degree; k++){
+        X_power[k] = X_power[k - 1] * X;
+    }
+
+    // the linear term of dc, every other term comes from (X + d)^degree - X^degree
+    for(int i = 0; i < SERIES_TERMS; i++){
+        power[i] = series[i];
+        next[i] = 0;
+    }
+    next[0] = state->series_radius;
+
+    for(int k = 1; k <= state->degree && k <= SERIES_TERMS; k++){
+        const double complex factor = state->binomial[k] * X_power[state->degree - k];
+        for(int i = k - 1; i < SERIES_TERMS; i++){
+            next[i] += factor * power[i];
+        }
+        if(k == state->degree || k == SERIES_TERMS) break;
+
+        // power becomes d^(k + 1), its lowest term is u^(k + 1)
+        for(int i = SERIES_TERMS - 1; i >= k; i--){
+            double complex sum = 0;
+            for(int j = k - 1; j < i; j++){
+                sum += power[j] * series[i - j - 1];
+            }
+            power[i] = sum;
+        }
+        power[k - 1] = 0;
+    }
+}
+
+/*
+ * Finds how many iterations of the reference orbit the series approximation can skip for every point of the view
+ * The series stops before an iteration where its last term is no longer small, or where a point could escape
+ */
+static void compute_series(perturbation_state* state){
+    state->series_skip = 0;
+    if(!(state->params->flags & GEN_SERIES_APPROXIMATION) || state->conjugate) return;
+
+    // the largest offset of a point from the reference is at one of the corners of the view
+    const complex_t lower_left = state->view.lower_left_offset;
+    const complex_t upper_right = state->view.upper_right_offset;
+    const double re = fmax(fabs(lower_left.re - state->reference_re), fabs(upper_right.re - state->reference_re));
+    const double im = fmax(fabs(lower_left.im - state->reference_im), fabs(upper_right.im - state->reference_im));
+    state->series_radius = hypot(re, im);
+
+    double complex series[SERIES_TERMS] = { state->series_radius };
+    for(size_t n = 0; n + 1 < state->orbit_length; n++){
+        const double complex X = state->orbit_re[n] + state->orbit_im[n] * I;
+
+        // |z| <= |X| + |d| and |d| <= the sum of the magnitudes of the coefficients, so no point escapes at iteration n
+        double bound = cabs(X);
+        for(int i = 0; i < SERIES_TERMS; i++){
+            bound += cabs(series[i]);
+        }
+        if(bound >= 2) break;
+
+        double complex next[SERIES_TERMS];
+        step_series(state, X, series, next);
+        if(!(cabs(next[SERIES_TERMS - 1]) < SERIES_TOLERANCE * cabs(next[0]))) break;
+
+        memcpy(series, next, sizeof(series));
+        state->series_skip = n + 1;
+    }
+    memcpy(state->series, series, sizeof(series));
+}
+
+/*
+ * Iterates the reference orbit of the point at offset (reference_re, reference_im) from the center of the view in high precision
+ */
+static void compute_reference_orbit(perturbation_state* state){
+    const byte max_iterations = state->grid->max_iterations;
+    const hp_real c_re = hp_add(state->view.center_re, hp_from_double(state->reference_re));
+    const hp_real c_im = hp_add(state->view.center_im, hp_from_double(state->reference_im));
+
+    hp_real z_re = c_re;
+    hp_real z_im = c_im;
+    state->orbit_length = 0;
+    for(size_t k = 0; k <= max_iterations; k++){
+        const double x = hp_to_double(z_re);
+        const double y = hp_to_double(z_im);
+        state->orbit_re[k] = x;
+        state->orbit_im[k] = y;
+        state->orbit_length = k + 1;
+        if(x * x + y * y > 4) break;
+
+        hp_real power_re, power_im;
+        hp_complex_power(&power_re, &power_im, z_re, z_im, state->degree);
+        z_re = hp_add(power_re, c_re);
+        z_im = state->conjugate ? hp_sub(c_im, power_im) : hp_add(power_im, c_im);
+    }
+    state->references++;
+    compute_series(state);
+}
+
+/*
+ * Creates the state of a perturbation render of a grid and iterates the reference orbit at the center of its view
+ * All points of the grid start out pending
+ */
+perturbation_state* create_perturbation_state(grid_t* grid, const grid_gen_params* params, const int degree, const bool conjugate){
+    if(degree < 2 || degree > MAX_PERTURBATION_DEGREE) return NULL;
+
+    perturbation_state* state = malloc(sizeof(perturbation_state));
+    if(!state) return NULL;
+
+    *state = (perturbation_state){
+        .grid = grid,
+        .degree = degree,
+        .conjugate = conjugate,
+        .params = params,
+        .orbit_re = malloc((grid->max_iterations + 1) * sizeof(double)),
+        .orbit_im = malloc((grid->max_iterations + 1) * sizeof(double)),
+        .pending = malloc(grid->size)
+    };
+    if(!state->orbit_re || !state->orbit_im || !state->pending){
+        fprintf(stderr, "Error allocating perturbation state for %zu grid points\n", grid->size);
+        free_perturbation_state(state);
+        return NULL;
+    }
+
+    if(params->view){
+        state->view = *params->view;
+    }
+    else {
+        // without a view, the grid is perturbed around the center of its corners
+        const complex_t center = {
+            .re = 0.5 * (grid->lower_left.re + grid->upper_right.re),
+            .im = 0.5 * (grid->lower_left.im + grid->upper_right.im)
+        };
+        state->view = (perturbation_view){
+            .center_re = hp_half(hp_add(hp_from_double(grid->lower_left.re), hp_from_double(grid->upper_right.re))),
+            .center_im = hp_half(hp_add(hp_from_double(grid->lower_left.im), hp_from_double(grid->upper_right.im))),
+            .lower_left_offset = { grid->lower_left.re - center.re, grid->lower_left.im - center.im },
+            .upper_right_offset = { grid->upper_right.re - center.re, grid->upper_right.im - center.im }
+        };
+    }
+
+    state->binomial[0] = 1;
+    for(int k = 1; k <= degree; k++){
+        state->binomial[k] = state->binomial[k - 1] * (degree - k + 1) / k;
+    }
+
+    memset(state->pending, 1, grid->size);
+    compute_reference_orbit(state);
+    state->first_series_skip = state->series_skip;
+    return state;
+}
+
+void free_perturbation_state(perturbation_state* state){
+    if(!state) return;
+
+    if(state->params->stats){
+        __atomic_fetch_add(&state->params->stats->references, state->references, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&state->params->stats->series_iterations, state->first_series_skip, __ATOMIC_RELAXED);
+    }
+    free(state->orbit_re);
+    free(state->orbit_im);
+    free(state->pending);
+    free(state);
+}
+
+/*
+ * Computes (X + d)^degree - X^degree, expanded so it does not cancel when d is much smaller than X
+ */
+static inline double complex power_difference(const perturbation_state* state, const double complex X, const double complex d){
+    if(state->degree == 2){
+        return d * (2 * X + d);
+    }
+
+    // Horner's method in d over the binomial expansion, X^(degree - k) is built up from the last term
+    double complex sum = state->binomial[state->degree];
+    double complex X_power = 1;
+    for(int k = state->degree - 1; k >= 1; k--){
+        X_power *= X;
+        sum = sum * d + state->binomial[k] * X_power;
+    }
+    return sum * d;
+}
+
+/*
+ * Iterates a point at offset dc from the reference point, with the same iteration count as the direct kernels
+ * glitched is set if the point has to be iterated against another reference
+ */
+static byte perturb_point(const perturbation_state* state, const double complex dc, bool* glitched){
+    const byte max_iterations = state->grid->max_iterations;
+    const double glitch_tolerance = GLITCH_TOLERANCE * GLITCH_TOLERANCE;
+    double complex d = dc;
+    byte iteration = 0;
+
+    // start from the series approximation of d, evaluated with Horner's method
+    if(state->series_skip > 0){
+        const double complex u = dc / state->series_radius;
+        d = state->series[SERIES_TERMS - 1];
+        for(int i = SERIES_TERMS - 2; i >= 0; i--){
+            d = d * u + state->series[i];
+        }
+        d *= u;
+        iteration = state->series_skip;
+    }
+
+    *glitched = false;
+    while(iteration < max_iterations){
+        // the reference escaped before this point did
+        if(iteration >= state->orbit_length){
+            *glitched = true;
+            break;
+        }
+
+        const double complex X = state->orbit_re[iteration] + state->orbit_im[iteration] * I;
+        const double complex z = X + d;
+        const double norm = creal(z) * creal(z) + cimag(z) * cimag(z);
+        if(norm > 4) break;
+        if(norm < glitch_tolerance * (creal(X) * creal(X) + cimag(X) * cimag(X))){
+            *glitched = true;
+            break;
+        }
+
+        const double complex difference = power_difference(state, X, d);
+        d = (state->conjugate ? conj(difference) : difference) + dc;
+        iteration++;
+    }
+    return iteration;
+}
+
+/*
+ * Iterates the pending points of a row against the current reference, points that glitch stay pending
+ * Rows can be perturbed in parallel
+ */
+void perturb_row(perturbation_state* state, const size_t row){
+    grid_t* grid = state->grid;
+    const complex_t lower_left = state->view.lower_left_offset;
+    const complex_t upper_right = state->view.upper_right_offset;
+    const double x_step = (upper_right.re - lower_left.re) / (double)grid->x;
+    const double y_step = (upper_right.im - lower_left.im) / (double)grid->y;
+    const double im = lower_left.im + row * y_step - state->reference_im;
+
+    for(size_t column = 0; column < grid->x; column++){
+        const size_t index = row * grid->x + column;
+        if(!state->pending[index]) continue;
+
+        bool glitched;
+        const double re = lower_left.re + column * x_step - state->reference_re;
+        grid->data[index] = perturb_point(state, re + im * I, &glitched);
+        state->pending[index] = glitched;
+    }
+}
+
+/*
+ * Picks a new reference orbit at one of the glitched points, if there are any left and the reference limit was not reached
+ * Returns true if the pending points have to be perturbed again
+ */
+bool next_reference(perturbation_state* state){
+    grid_t* grid = state->grid;
+    size_t glitched = 0;
+    for(size_t i = 0; i < grid->size; i++){
+        glitched += state->pending[i];
+    }
+    if(glitched == 0 || state->references >= MAX_REFERENCES) return false;
+
+    // the middle glitched point, in the order of the grid
+    size_t index = 0;
+    for(size_t seen = 0; index < grid->size; index++){
+        if(state->pending[index] && seen++ == glitched / 2) break;
+    }
+
+    const complex_t lower_left = state->view.lower_left_offset;
+    const complex_t upper_right = state->view.upper_right_offset;
+    state->reference_re = lower_left.re + (index % grid->x) * ((upper_right.re - lower_left.re) / (double)grid->x);
+    state->reference_im = lower_left.im + (index / grid->x) * ((upper_right.im - lower_left.im) / (double)grid->y);
+    compute_reference_orbit(state);
+    return true;
+}
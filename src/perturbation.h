@@ -0,0 +1,49 @@
+/*
+ * Perturbation rendering of deep zooms into the mandelbrot, tricorn, and integer degree multibrot and multicorn sets
+ *
+ * A single reference orbit is iterated in high precision, every other point is iterated in double precision
+ * as its difference from the reference. Points where the difference grows as large as the reference itself are glitched,
+ * they are iterated again against a new reference orbit started at one of the glitched points
+ *
+ * With GEN_SERIES_APPROXIMATION the difference is also approximated by a polynomial in the offset of the point,
+ * iterated along the reference orbit, so every point can start at the last iteration where the polynomial is accurate
+ * instead of at 0. This needs an analytic iteration, so it is not used for the tricorn and multicorn sets
+ *
+ * The traversal of the rows is left to the backends, see perturbation_traverse in serial-fractals.c and shared-fractals.c
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "fractals.h"
+#include "grids.h"
+
+// the most reference orbits used for a grid, points that are still glitched after that keep their glitched value
+#ifndef MAX_REFERENCES
+#define MAX_REFERENCES 16
+#endif
+
+// a point is glitched once |z| falls below this fraction of the magnitude of the reference orbit
+#ifndef GLITCH_TOLERANCE
+#define GLITCH_TOLERANCE 1e-3
+#endif
+
+// the number of terms of the series in the offset of a point that approximates its difference from the reference orbit
+#ifndef SERIES_TERMS
+#define SERIES_TERMS 4
+#endif
+
+// the series approximation is used as long as its last term stays below this fraction of its first
+#ifndef SERIES_TOLERANCE
+#define SERIES_TOLERANCE 1e-8
+#endif
+
+// the largest degree supported by perturbation
+#define MAX_PERTURBATION_DEGREE 16
+
+typedef struct perturbation_state perturbation_state;
+
+perturbation_state* create_perturbation_state(grid_t* grid, const grid_gen_params* params, const int degree, const bool conjugate);
+void perturb_row(perturbation_state* state, const size_t row);
+bool next_reference(perturbation_state* state);
+void free_perturbation_state(perturbation_state* state);
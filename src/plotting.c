@@ -1,51 +1,263 @@
+/*
+ * Gradients and the colors of grids, see plotting.h
+ */
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include "plotting.h"
 
+static const char* const gradient_names[GRADIENT_COUNT] = {
+    [GRADIENT_GREEN] = "green",
+    [GRADIENT_INVERSE] = "inverse",
+    [GRADIENT_FIRE] = "fire",
+    [GRADIENT_CYCLIC] = "cyclic",
+    [GRADIENT_EQUALIZED] = "equalized"
+};
+
+/*
+ * Finds a gradient by its name
+ * Returns the gradient, or -1 if there is no gradient with that name
+ */
+gradient parse_gradient(const char* name){
+    for(int map = 0; map < GRADIENT_COUNT; map++){
+        if(strcmp(name, gradient_names[map]) == 0) return map;
+    }
+    return -1;
+}
+
+static inline unsigned char clamp_channel(const int value){
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/*
+ * Gets a color of the palette of a gradient, the palettes run from index 0 for the fastest escaping points to
+ * INTERIOR_INDEX - 1, and INTERIOR_INDEX is black for the points inside the set
+ */
+color palette_color(const gradient map, const byte index){
+    if(index == INTERIOR_INDEX) return (color){ 0, 0, 0 };
+
+    switch(map){
+        case GRADIENT_INVERSE:
+            return (color){ 0, 255 - index, (255 - index) / 2 };
+        case GRADIENT_FIRE:
+            return (color){ clamp_channel(3 * index), clamp_channel(3 * index - 255), clamp_channel(3 * index - 510) };
+        case GRADIENT_CYCLIC: {
+            const double angle = 2 * M_PI * index / INTERIOR_INDEX;
+            return (color){
+                clamp_channel(127.5 + 127.5 * sin(angle)),
+                clamp_channel(127.5 + 127.5 * sin(angle + 2 * M_PI / 3)),
+                clamp_channel(127.5 + 127.5 * sin(angle + 4 * M_PI / 3))
+            };
+        }
+        default:
+            return (color){ 0, index, index / 2 };
+    }
+}
+
+/*
+ * Maps an iteration count onto the palette of a gradient without a histogram,
+ * the histogram-equalized gradient falls back to the linear mapping
+ */
+static byte palette_index(const size_t iterations, const size_t max_iterations, const gradient map){
+    if(iterations >= max_iterations) return INTERIOR_INDEX;
+    if(map == GRADIENT_CYCLIC){
+        return iterations % CYCLE_ITERATIONS * INTERIOR_INDEX / CYCLE_ITERATIONS;
+    }
+    return (byte)((double)iterations / max_iterations * 255);
+}
+
 /*
  * Gets the corresponding color for a given number of iterations according to a gradient
  */
 color get_color(const size_t iterations, const size_t max_iterations, const gradient map){
-    const size_t val = (max_iterations - iterations) / max_iterations;
-    color color;
-
-    //TODO: map the interval of [0,max_iterations] to a value given a gradient
-    return color;
+    return palette_color(map, palette_index(iterations, max_iterations, map));
 }
 
 /*
  * Gets the associated "red" value for a given number of iterations according to a gradient
  */
-char get_red(const size_t iterations, const size_t max_iterations, const gradient map){
-    char red;
-
-    return red;
+unsigned char get_red(const size_t iterations, const size_t max_iterations, const gradient map){
+    return get_color(iterations, max_iterations, map).red;
 }
 
 /*
  * Gets the associated "green" value for a given number of iterations according to a gradient
  */
-char get_green(const size_t iterations, const size_t max_iterations, const gradient map){
-    char green;
-
-    return green;
+unsigned char get_green(const size_t iterations, const size_t max_iterations, const gradient map){
+    return get_color(iterations, max_iterations, map).green;
 }
 
 /*
  * Gets the associated "blue" value for a given number of iterations according to a gradient
  */
-char get_blue(const size_t iterations, const size_t max_iterations, const gradient map){
-    char blue;
+unsigned char get_blue(const size_t iterations, const size_t max_iterations, const gradient map){
+    return get_color(iterations, max_iterations, map).blue;
+}
+
+/*
+ * Spreads the escaped iteration counts over the palette by their cumulative share of the escaped points,
+ * so every palette index colors about as many points
+ */
+static void equalize_indices(byte index[256], const byte max_iterations, const size_t* histogram){
+    size_t escaped = 0;
+    for(int i = 0; i < max_iterations; i++){
+        escaped += histogram[i];
+    }
+
+    size_t cumulative = 0;
+    for(int i = 0; i < 256; i++){
+        if(i >= max_iterations){
+            index[i] = INTERIOR_INDEX;
+            continue;
+        }
+        cumulative += histogram[i];
+        index[i] = escaped ? (INTERIOR_INDEX - 1) * cumulative / escaped : 0;
+    }
+}
+
+/*
+ * Resolves the color of every iteration count of a grid with max_iterations
+ * The histogram of the grid, see grid_histogram, is only needed by GRADIENT_EQUALIZED and may be NULL otherwise
+ *
+ * Returns false if the gradient does not exist or needs a histogram that was not given
+ */
+bool build_gradient_lut(gradient_lut* lut, const gradient map, const byte max_iterations, const size_t* histogram){
+    if(map < 0 || map >= GRADIENT_COUNT || (map == GRADIENT_EQUALIZED && !histogram)) return false;
+
+    if(map == GRADIENT_EQUALIZED){
+        equalize_indices(lut->index, max_iterations, histogram);
+    }
+    else {
+        for(int i = 0; i < 256; i++){
+            lut->index[i] = palette_index(i, max_iterations, map);
+        }
+    }
+
+    for(int i = 0; i < 256; i++){
+        const color c = palette_color(map, lut->index[i]);
+        lut->packed[i] = c.red << 16 | c.green << 8 | c.blue;
+    }
+    return true;
+}
+
+/*
+ * Colors a span of iteration counts one at a time
+ */
+static void colorize_span(unsigned char* red, unsigned char* green, unsigned char* blue, const byte* data, const size_t size, const int* packed){
+    for(size_t i = 0; i < size; i++){
+        const int color = packed[data[i]];
+        red[i] = color >> 16;
+        green[i] = color >> 8;
+        blue[i] = color;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/*
+ * Colors a span of iteration counts 8 at a time, the packed colors of the counts are gathered into a vector
+ * and shuffled apart into 8 bytes of each plane
+ */
+__attribute__((target("avx2")))
+static void colorize_span_avx2(unsigned char* red, unsigned char* green, unsigned char* blue, const byte* data, const size_t size, const int* packed){
+    // the red, green and blue bytes of the 4 colors of a lane into its first 3 dwords
+    const __m256i planes = _mm256_setr_epi8(
+        2, 6, 10, 14, 1, 5, 9, 13, 0, 4, 8, 12, -1, -1, -1, -1,
+        2, 6, 10, 14, 1, 5, 9, 13, 0, 4, 8, 12, -1, -1, -1, -1
+    );
+    // the dwords of both lanes of a plane next to each other
+    const __m256i join = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        const __m256i counts = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(data + i)));
+        const __m256i colors = _mm256_i32gather_epi32(packed, counts, 4);
+        const __m256i split = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(colors, planes), join);
+        const __m128i red_green = _mm256_castsi256_si128(split);
+        const __m128i blue_bytes = _mm256_extracti128_si256(split, 1);
+        _mm_storel_epi64((__m128i*)(red + i), red_green);
+        _mm_storel_epi64((__m128i*)(green + i), _mm_unpackhi_epi64(red_green, red_green));
+        _mm_storel_epi64((__m128i*)(blue + i), blue_bytes);
+    }
+    colorize_span(red + i, green + i, blue + i, data + i, size - i, packed);
+}
+#endif
+
+typedef void (*span_colorizer)(unsigned char*, unsigned char*, unsigned char*, const byte*, const size_t, const int*);
+
+/*
+ * Selects the AVX2 gathers if the cpu supports them
+ */
+static span_colorizer select_colorizer(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return colorize_span_avx2;
+    }
+#endif
+    return colorize_span;
+}
+
+/*
+ * Colors the rows of a grid into the planes of colors, which must have the dimensions of the grid
+ * Shares the rows out between the threads of the enclosing parallel region
+ */
+static void colorize_rows(colors_t* colors, const grid_t* grid, const int* packed, const span_colorizer span){
+    const size_t width = grid->x;
+    const size_t height = grid->y;
+
+    #pragma omp for schedule(static)
+    for(size_t y = 0; y < height; y++){
+        const size_t offset = y * width;
+        span(colors->red + offset, colors->green + offset, colors->blue + offset, grid->data + offset, width, packed);
+    }
+}
+
+/*
+ * Colors every point of a grid with a gradient in a single parallel region
+ * If the gradient is histogram-equalized and no histogram of the grid is given, the threads count their rows
+ * into local histograms first, which are merged before the lookup table is built once for all of them
+ *
+ * Returns false if the gradient does not exist
+ */
+bool colorize_gradient(colors_t* colors, const grid_t* grid, const gradient map, const size_t* histogram){
+    if(map < 0 || map >= GRADIENT_COUNT) return false;
 
-    return blue;
+    const size_t width = grid->x;
+    const size_t height = grid->y;
+    const span_colorizer span = select_colorizer();
+    const bool count = map == GRADIENT_EQUALIZED && !histogram;
+    size_t counted[256] = { 0 };
+    gradient_lut lut;
+
+    #pragma omp parallel default(none) shared(colors, grid, map, histogram, width, height, span, count, counted, lut)
+    {
+        if(count){
+            size_t counts[HISTOGRAM_LANES][256] = { 0 };
+            #pragma omp for schedule(static) nowait
+            for(size_t y = 0; y < height; y++){
+                count_iterations(counts, grid->data + y * width, width);
+            }
+            #pragma omp critical
+            merge_histogram_lanes(counted, counts);
+            #pragma omp barrier
+        }
+
+        #pragma omp single
+        build_gradient_lut(&lut, map, grid->max_iterations, count ? counted : histogram);
+
+        colorize_rows(colors, grid, lut.packed, span);
+    }
+    return true;
 }
 
 colors_t* create_colors(const size_t x, const size_t y){
     if(x <= 0 || y <= 0) return NULL;
 
-    char* red = malloc(x*y);
-    char* green = malloc(x*y);
-    char* blue = malloc(x*y);
+    unsigned char* red = malloc(x*y);
+    unsigned char* green = malloc(x*y);
+    unsigned char* blue = malloc(x*y);
     
     if(!red || !green || !blue){
         free(red); free(green); free(blue);
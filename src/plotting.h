@@ -1,31 +1,76 @@
+/*
+ * Gradients that color the iterations of a grid
+ *
+ * A gradient is a palette of 256 colors and a mapping of the iteration counts of a grid onto it.
+ * The palette index of every iteration count is resolved once into a gradient_lut, which colorize_gradient uses
+ * to fill the planes of a colors_t without branching on the gradient per pixel
+ */
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include "grids.h"
+
+// the palette index of the points inside the set, black in every palette
+#define INTERIOR_INDEX 255
+
+// the iterations it takes the cyclic gradient to go around its palette once
+#define CYCLE_ITERATIONS 32
+
+enum gradients {
+    // linear green ramp, the png default
+    GRADIENT_GREEN,
+    // linear green ramp from bright to dark, the gif default
+    GRADIENT_INVERSE,
+    // linear ramp from black through red and yellow to white
+    GRADIENT_FIRE,
+    // rainbow that repeats every CYCLE_ITERATIONS iterations
+    GRADIENT_CYCLIC,
+    // green ramp spread evenly over the iterations of the grid by histogram equalization
+    GRADIENT_EQUALIZED,
+    GRADIENT_COUNT
+};
+
+// lets a renderer pick its own default gradient
+#define GRADIENT_DEFAULT -1
 
 typedef struct {
-    char red;
-    char green;
-    char blue;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
 } color;
 
 typedef struct {
     size_t x;
     size_t y;
     size_t size;
-    char* red;
-    char* green;
-    char* blue;
+    unsigned char* red;
+    unsigned char* green;
+    unsigned char* blue;
 } colors_t;
 
-typedef char gradient;
+typedef signed char gradient;
+
+// the coloring of every iteration count of a grid
+typedef struct {
+    // the palette index of every iteration count
+    byte index[256];
+    // the color of every iteration count as 0xRRGGBB, packed so a vector of counts can be colored by one gather
+    int packed[256];
+} gradient_lut;
+
+gradient parse_gradient(const char* name);
 
 // for AoS
 color get_color(const size_t iterations, const size_t max_iterations, const gradient map);
 
 // for SoA
-char get_red(const size_t iterations, const size_t max_iterations, const gradient map);
-char get_green(const size_t iterations, const size_t max_iterations, const gradient map);
-char get_blue(const size_t iterations, const size_t max_iterations, const gradient map);
+unsigned char get_red(const size_t iterations, const size_t max_iterations, const gradient map);
+unsigned char get_green(const size_t iterations, const size_t max_iterations, const gradient map);
+unsigned char get_blue(const size_t iterations, const size_t max_iterations, const gradient map);
+color palette_color(const gradient map, const byte index);
+bool build_gradient_lut(gradient_lut* lut, const gradient map, const byte max_iterations, const size_t* histogram);
+bool colorize_gradient(colors_t* colors, const grid_t* grid, const gradient map, const size_t* histogram);
 colors_t* create_colors(size_t x, size_t y);
 colors_t* copy_colors(const colors_t* colors);
 void free_colors(colors_t* colors);
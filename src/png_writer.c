@@ -0,0 +1,286 @@
+/*
+ * Parallel PNG writer, see png_writer.h
+ */
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "png_writer.h"
+
+// the size of the deflate window, the most a band can take from the band before it as its dictionary
+#define DEFLATE_WINDOW_SIZE 32768
+
+// 8 bit RGB
+#define PNG_BYTES_PER_PIXEL 3
+#define PNG_COLOR_TYPE_RGB 2
+
+enum png_filter {
+    FILTER_NONE,
+    FILTER_SUB,
+    FILTER_UP,
+    FILTER_AVERAGE,
+    FILTER_PAETH,
+    FILTER_COUNT
+};
+
+// a band of rows after it has been deflated
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    // the adler32 of the filtered rows of the band and their size, which are combined into the checksum of the stream
+    uLong adler;
+    size_t filtered_size;
+} png_band;
+
+static inline void put_u32(unsigned char* out, const uint32_t value){
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+/*
+ * Writes a chunk of a png file
+ * Returns false if it could not be written
+ */
+static bool write_chunk(FILE* file, const char type[4], const unsigned char* data, const size_t length){
+    unsigned char header[8];
+    put_u32(header, length);
+    memcpy(header + 4, type, 4);
+    // crc32 returns its initial value for a NULL buffer, so the data of empty chunks is left out
+    uLong checksum = crc32(0, header + 4, 4);
+    if(length){
+        checksum = crc32(checksum, data, length);
+    }
+    unsigned char crc[4];
+    put_u32(crc, checksum);
+
+    return fwrite(header, 1, 8, file) == 8 &&
+        fwrite(data, 1, length, file) == length &&
+        fwrite(crc, 1, 4, file) == 4;
+}
+
+/*
+ * Interleaves a row of the planes of an image into RGB bytes
+ */
+static void unpack_row(unsigned char* out, const colors_t* image, const size_t y){
+    const size_t offset = y * image->x;
+    for(size_t x = 0; x < image->x; x++){
+        out[3 * x] = image->red[offset + x];
+        out[3 * x + 1] = image->green[offset + x];
+        out[3 * x + 2] = image->blue[offset + x];
+    }
+}
+
+static inline unsigned char paeth_predictor(const int a, const int b, const int c){
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if(pa <= pb && pa <= pc) return a;
+    if(pb <= pc) return b;
+    return c;
+}
+
+/*
+ * Computes a filtered byte of a row, previous is a row of zeros for the first row of the image
+ */
+static inline unsigned char filter_byte(const enum png_filter filter, const unsigned char* row, const unsigned char* previous, const size_t i){
+    const int left = i >= PNG_BYTES_PER_PIXEL ? row[i - PNG_BYTES_PER_PIXEL] : 0;
+    const int up = previous[i];
+    const int up_left = i >= PNG_BYTES_PER_PIXEL ? previous[i - PNG_BYTES_PER_PIXEL] : 0;
+    switch(filter){
+        case FILTER_SUB:
+            return row[i] - left;
+        case FILTER_UP:
+            return row[i] - up;
+        case FILTER_AVERAGE:
+            return row[i] - (left + up) / 2;
+        case FILTER_PAETH:
+            return row[i] - paeth_predictor(left, up, up_left);
+        default:
+            return row[i];
+    }
+}
+
+/*
+ * Filters a row into its filter type byte followed by the filtered bytes
+ * With adaptive set the filter is the one whose bytes have the smallest sum as signed values, the heuristic libpng uses,
+ * otherwise rows are stored unfiltered
+ */
+static void filter_row(unsigned char* out, const unsigned char* row, const unsigned char* previous, const size_t row_bytes, const bool adaptive){
+    enum png_filter best = FILTER_NONE;
+    if(adaptive){
+        unsigned long best_sum = ULONG_MAX;
+        for(int filter = FILTER_NONE; filter < FILTER_COUNT; filter++){
+            unsigned long sum = 0;
+            for(size_t i = 0; i < row_bytes && sum < best_sum; i++){
+                sum += abs((signed char)filter_byte(filter, row, previous, i));
+            }
+            if(sum < best_sum){
+                best_sum = sum;
+                best = filter;
+            }
+        }
+    }
+
+    out[0] = best;
+    for(size_t i = 0; i < row_bytes; i++){
+        out[i + 1] = filter_byte(best, row, previous, i);
+    }
+}
+
+/*
+ * Filters and deflates the rows [first, last) of an image into a raw deflate stream
+ * The filtered rows before first that fit in the deflate window are filtered again to serve as the dictionary,
+ * the band ends with a sync flush, or finishes the stream if it is the last band of the image
+ *
+ * Returns false if the band could not be allocated or deflated
+ */
+static bool deflate_band(png_band* band, const colors_t* image, const size_t first, const size_t last, const int level){
+    const size_t width = image->x;
+    const size_t height = image->y;
+    const size_t row_bytes = width * PNG_BYTES_PER_PIXEL;
+    const size_t line_bytes = row_bytes + 1;
+    const size_t window_rows = (DEFLATE_WINDOW_SIZE + line_bytes - 1) / line_bytes;
+    const size_t dictionary_rows = first < window_rows ? first : window_rows;
+    const size_t start = first - dictionary_rows;
+
+    unsigned char* filtered = malloc((last - start) * line_bytes);
+    unsigned char* row = malloc(row_bytes);
+    unsigned char* previous = calloc(row_bytes, 1);
+    if(!filtered || !row || !previous){
+        fprintf(stderr, "Error allocating a band of %zu png rows\n", last - first);
+        free(filtered); free(row); free(previous);
+        return false;
+    }
+
+    if(start > 0){
+        unpack_row(previous, image, start - 1);
+    }
+    for(size_t y = start; y < last; y++){
+        unpack_row(row, image, y);
+        filter_row(filtered + (y - start) * line_bytes, row, previous, row_bytes, level != 0);
+        unsigned char* swap = previous;
+        previous = row;
+        row = swap;
+    }
+    free(row);
+    free(previous);
+
+    const size_t dictionary_size = dictionary_rows * line_bytes;
+    const unsigned char* data = filtered + dictionary_size;
+    band->filtered_size = (last - first) * line_bytes;
+    band->adler = adler32(1, data, band->filtered_size);
+
+    z_stream stream = { .zalloc = Z_NULL, .zfree = Z_NULL, .opaque = Z_NULL };
+    if(deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        free(filtered);
+        return false;
+    }
+    if(dictionary_size){
+        const size_t used = dictionary_size < DEFLATE_WINDOW_SIZE ? dictionary_size : DEFLATE_WINDOW_SIZE;
+        deflateSetDictionary(&stream, data - used, used);
+    }
+
+    // the sync flush adds an empty stored block to what deflateBound allows for
+    const size_t bound = deflateBound(&stream, band->filtered_size) + 16;
+    band->data = malloc(bound);
+    if(!band->data){
+        fprintf(stderr, "Error allocating %zu bytes for a deflated png band\n", bound);
+        deflateEnd(&stream);
+        free(filtered);
+        return false;
+    }
+
+    const bool final = last == height;
+    stream.next_in = (unsigned char*)data;
+    stream.avail_in = band->filtered_size;
+    stream.next_out = band->data;
+    stream.avail_out = bound;
+    const int status = deflate(&stream, final ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool complete = final ? status == Z_STREAM_END : status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0;
+    band->size = bound - stream.avail_out;
+    deflateEnd(&stream);
+    free(filtered);
+    if(!complete){
+        fprintf(stderr, "Error deflating the png rows %zu to %zu\n", first, last);
+        free(band->data);
+        band->data = NULL;
+    }
+    return complete;
+}
+
+/*
+ * Writes the zlib header of the image data, the compression level it records is only informative
+ */
+static bool write_zlib_header(FILE* file, const int level){
+    const int compression_info = 0x78;
+    const int level_flag = level == PNG_DEFAULT_LEVEL || level == 6 ? 2 : level < 2 ? 0 : level < 6 ? 1 : 3;
+    int flags = level_flag << 6;
+    flags += 31 - (compression_info * 256 + flags) % 31;
+    const unsigned char header[2] = { compression_info, flags };
+    return write_chunk(file, "IDAT", header, 2);
+}
+
+/*
+ * Writes the planes of an image as an 8 bit RGB png
+ * level is the zlib compression level from 0 (stored) to 9 (smallest), or PNG_DEFAULT_LEVEL for the zlib default.
+ * Level 0 also skips filtering the rows, for quick previews
+ *
+ * Returns 0 on success, or PNG_WRITE_ERROR
+ */
+int write_png(FILE* file, const colors_t* image, const int level){
+    const size_t width = image->x;
+    const size_t height = image->y;
+    if(width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX || level < PNG_DEFAULT_LEVEL || level > 9){
+        return PNG_WRITE_ERROR;
+    }
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char header[13];
+    put_u32(header, width);
+    put_u32(header + 4, height);
+    header[8] = 8;
+    header[9] = PNG_COLOR_TYPE_RGB;
+    // deflate compression, adaptive filtering and no interlacing
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    if(fwrite(signature, 1, 8, file) != 8 || !write_chunk(file, "IHDR", header, 13) || !write_zlib_header(file, level)){
+        return PNG_WRITE_ERROR;
+    }
+
+    // the bands are deflated in parallel and written in order as they finish
+    const size_t bands = (height + PNG_BAND_ROWS - 1) / PNG_BAND_ROWS;
+    uLong adler = 1;
+    bool success = true;
+    #pragma omp parallel for default(none) shared(file, image, height, level, bands, adler, success) ordered schedule(static, 1)
+    for(size_t i = 0; i < bands; i++){
+        const size_t first = i * PNG_BAND_ROWS;
+        const size_t last = first + PNG_BAND_ROWS < height ? first + PNG_BAND_ROWS : height;
+        png_band band = { .data = NULL };
+        const bool deflated = deflate_band(&band, image, first, last, level);
+
+        #pragma omp ordered
+        {
+            if(success && deflated && write_chunk(file, "IDAT", band.data, band.size)){
+                adler = adler32_combine(adler, band.adler, band.filtered_size);
+            }
+            else {
+                success = false;
+            }
+        }
+        free(band.data);
+    }
+    if(!success) return PNG_WRITE_ERROR;
+
+    unsigned char checksum[4];
+    put_u32(checksum, adler);
+    if(!write_chunk(file, "IDAT", checksum, 4) || !write_chunk(file, "IEND", NULL, 0)){
+        return PNG_WRITE_ERROR;
+    }
+    return 0;
+}
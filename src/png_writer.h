@@ -0,0 +1,25 @@
+/*
+ * Parallel PNG writer for the color planes of images, see plotting.h
+ *
+ * The rows of an image are split into bands of PNG_BAND_ROWS rows which are filtered and deflated as independent tasks.
+ * Every band is deflated with the end of the band before it as its dictionary and ends with a sync flush,
+ * so the bands join into one zlib stream that is written as the IDAT chunks of the image, one per band
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include "plotting.h"
+
+// the rows of a band that is filtered and deflated as one task
+#ifndef PNG_BAND_ROWS
+#define PNG_BAND_ROWS 64
+#endif
+
+// the zlib level used when none is chosen, see write_png
+#define PNG_DEFAULT_LEVEL -1
+
+// png write errors
+#define PNG_WRITE_ERROR 2
+
+int write_png(FILE* file, const colors_t* image, const int level);
@@ -2,9 +2,18 @@
  * Header that allows conditional compilation into double floating point precisions ot extended double floating point precision
  *
  * CUDA does not support long double so cuda-fractals may fail to compile or have unexpected behavior if linked with code that was compiled with EXTENDED_PRECISION
+ *
+ * DOUBLE_DOUBLE_PRECISION keeps CBASE a double, but stores the corners of a grid as double-doubles (see double_double.h and complex_t)
+ * and iterates points in double-double in the vector kernels, which gives about 106 bits of mantissa
  */
 #pragma once
 
+#include <float.h>
+
+#if defined(EXTENDED_PRECISION) && defined(DOUBLE_DOUBLE_PRECISION)
+#error EXTENDED_PRECISION and DOUBLE_DOUBLE_PRECISION can not be combined
+#endif
+
 #ifdef EXTENDED_PRECISION
 
 #warning Compiling with extended precision, will lead to code incompatibility
@@ -15,6 +24,7 @@
 #define CONJ conjl
 #define CABS cabsl
 #define RABS fabsl
+#define CEPSILON LDBL_EPSILON
 #define CFORMAT "%Lf"
 
 #endif
@@ -27,6 +37,7 @@
 #define CONJ conj
 #define CABS cabs
 #define RABS fabs
+#define CEPSILON DBL_EPSILON
 #define CFORMAT "%lf"
 
 #endif
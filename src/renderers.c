@@ -1,67 +1,56 @@
 #include "renderers.h"
 #include <stdio.h>
+#include <string.h>
 #include "fractal_render.h"
 #include <gd.h>
+#include "plotting.h"
+#include "png_writer.h"
 
-static inline byte scale_iterations(const byte max_iterations, const byte iteration){
-    return (byte)((double)iteration / max_iterations * 255);
-}
+// the longest file name of a frame in a frame list
+#define FRAME_NAME_SIZE 256
 
 /*
- * Convert a grid into a gd image with true color
- * NOTE: modifying the size of colors will allow this function to use the 
- *       millions of colors the true colors support
- * As of now it is identical to converter, but should be changed
+ * Resolves the gradient a grid is colored with
+ * The histogram-equalized gradient counts the iterations of the grid first
+ *
+ * Returns false if the gradient could not be resolved
  */
-gdImagePtr truecolor_converter(const grid_t* grid){
-    const size_t width = grid->x;
-    const size_t height = grid->y;
-    const byte* data = grid->data;
-    const byte max_iterations = grid->max_iterations;
-
-    gdImagePtr img = gdImageCreateTrueColor(width, height);
-    int colors[256];
-    for(size_t i = 0; i < 255; i++){
-        colors[i] = gdImageColorAllocate(img, 0, i, i/2);
+static bool grid_gradient(gradient_lut* lut, const grid_t* grid, const gradient map){
+    size_t histogram[256];
+    if(map == GRADIENT_EQUALIZED){
+        grid_histogram(grid, histogram);
     }
-
-    colors[255] = gdImageColorAllocate(img, 0, 0, 0);
-
-    for(size_t y = 0; y < height; y++){
-        for(size_t x = 0; x < width; x++){
-            byte iteration = data[y * width + x];
-            byte scaled_iteration = scale_iterations(max_iterations, iteration);
-            int color = colors[scaled_iteration];
-            gdImageSetPixel(img, x, y, color);
-        }
+    if(!build_gradient_lut(lut, map, grid->max_iterations, histogram)){
+        fprintf(stderr, "Error coloring the grid, unknown gradient %d\n", map);
+        return false;
     }
-
-    return img;
+    return true;
 }
 
 /*
  * Convert a grid into a gd image
+ * The palette of the image is the palette of the gradient in order, so the palette indices of the gradient
+ * are written straight into the rows of the image
  */
-gdImagePtr converter(const grid_t* grid){
+gdImagePtr converter(const grid_t* grid, const gradient_lut* lut, const gradient map){
     const size_t width = grid->x;
     const size_t height = grid->y;
     const byte* data = grid->data;
-    const byte max_iterations = grid->max_iterations;
 
     gdImagePtr img = gdImageCreate(width, height);
-    int colors[256];
-    for(size_t i = 0; i < 255; i++){
-        colors[i] = gdImageColorAllocate(img, 0, 255-i, (255-i)/2);
-    }
+    if(!img) return NULL;
 
-    colors[255] = gdImageColorAllocate(img, 0, 0, 0);
+    for(int i = 0; i < 256; i++){
+        const color c = palette_color(map, i);
+        gdImageColorAllocate(img, c.red, c.green, c.blue);
+    }
 
+    #pragma omp parallel for default(none) shared(img, data, lut, width, height) schedule(static)
     for(size_t y = 0; y < height; y++){
+        const byte* row = data + y * width;
+        unsigned char* pixels = img->pixels[y];
         for(size_t x = 0; x < width; x++){
-            byte iteration = data[y * width + x];
-            byte scaled_iteration = scale_iterations(max_iterations, iteration);
-            int color = colors[scaled_iteration];
-            gdImageSetPixel(img, x, y, color);
+            pixels[x] = lut->index[row[x]];
         }
     }
 
@@ -69,31 +58,129 @@ gdImagePtr converter(const grid_t* grid){
 }
 
 
-void render_png(FILE *output, const renderer_params* params){
-    gdImagePtr img = truecolor_converter(params->grid);
-    gdImagePng(img, output);
-    gdImageDestroy(img);
+/*
+ * Renders a grid as a png, the grid is colorized into color planes which are filtered and compressed in parallel by write_png
+ * A histogram-equalized grid is counted and colored in the same parallel pass, unless the histogram was read from the generator
+ *
+ * Returns 0 on success, or RENDER_ERROR
+ */
+int render_png(FILE *output, const renderer_params* params){
+    const grid_t* grid = params->grid;
+    const gradient map = params->gradient == GRADIENT_DEFAULT ? GRADIENT_GREEN : params->gradient;
+
+    colors_t* image = create_colors(grid->x, grid->y);
+    if(!image){
+        fprintf(stderr, "Error creating a %zux%zu image\n", grid->x, grid->y);
+        return RENDER_ERROR;
+    }
+    if(!colorize_gradient(image, grid, map, params->histogram)){
+        fprintf(stderr, "Error coloring the grid, unknown gradient %d\n", map);
+        free_colors(image);
+        return RENDER_ERROR;
+    }
+    const int status = write_png(output, image, params->compression_level);
+    if(status == PNG_WRITE_ERROR){
+        fprintf(stderr, "Error occured while writing the png\n");
+    }
+    free_colors(image);
+    return status == PNG_WRITE_ERROR ? RENDER_ERROR : 0;
 }
 
-void render_gif(FILE* output, const renderer_params* params){
-    const size_t size = params->grid_array.size;
-    grid_t** grids = params->grid_array.grids;
-    const int delay = params->grid_array.delay;
+// what read_frame found in a frame list
+enum frame_status {
+    FRAME_READ,
+    FRAME_END,
+    FRAME_ERROR
+};
 
-    gdImagePtr imgs[size];
+/*
+ * Reads the next grid of a frame list and converts it into a frame with the palette of the frame before it
+ * The grid is released as soon as it is converted, only the image of the frame is kept
+ *
+ * Returns FRAME_READ with the frame in img, FRAME_END at the end of the list,
+ * or FRAME_ERROR if the frame listed next could not be read or converted
+ */
+static enum frame_status read_frame(FILE* frame_list, const gradient map, const gdImagePtr previous, gdImagePtr* img){
+    *img = NULL;
+    char filename[FRAME_NAME_SIZE];
+    if(!fgets(filename, sizeof(filename), frame_list)) return FRAME_END;
+    //remove trailing newline from fgets
+    filename[strcspn(filename, "\n")] = 0;
+
+    FILE* file = fopen(filename, "rb");
+    if(!file){
+        fprintf(stderr, "Error opening frame %s\n", filename);
+        return FRAME_ERROR;
+    }
+    bool mapped;
+    grid_t* grid = load_grid(file, filename, &mapped);
+    fclose(file);
+    if(!grid){
+        fprintf(stderr, "Error reading frame %s\n", filename);
+        return FRAME_ERROR;
+    }
 
-    imgs[0] = converter(grids[0]);
-    gdImageGifAnimBegin(imgs[0], output, 1, 0);
-    gdImageGifAnimAdd(imgs[0], output, 0, 0, 0, delay, 1, NULL);
+    gradient_lut lut;
+    *img = grid_gradient(&lut, grid, map) ? converter(grid, &lut, map) : NULL;
+    if(mapped){
+        unmap_grid(grid);
+    }
+    else {
+        free_grid(grid);
+    }
+    if(!*img){
+        fprintf(stderr, "Error converting frame %s\n", filename);
+        return FRAME_ERROR;
+    }
+    if(previous){
+        gdImagePaletteCopy(*img, previous);
+    }
+    return FRAME_READ;
+}
 
-    for(size_t i = 1; i < size; i++){
-        imgs[i] = converter(grids[i]);
-        gdImagePaletteCopy(imgs[i], imgs[i-1]);
-        gdImageGifAnimAdd(imgs[i], output, 0, 0, 0, delay, 1, imgs[i-1]);
+/*
+ * Renders the frames of a frame list as an animated gif, streaming them one at a time
+ * Only the frame being encoded and the frame before it, which it is encoded as a difference from, are kept.
+ * A task reads and converts the next frame while the current one is encoded
+ *
+ * Returns 0 on success, or RENDER_ERROR if a listed frame could not be read, in which case the animation is left unfinished
+ */
+int render_gif(FILE* output, const renderer_params* params){
+    FILE* frame_list = params->animation.frames;
+    const int delay = params->animation.delay;
+    const gradient map = params->gradient == GRADIENT_DEFAULT ? GRADIENT_INVERSE : params->gradient;
+
+    gdImagePtr frame;
+    enum frame_status status = read_frame(frame_list, map, NULL, &frame);
+    if(status != FRAME_READ){
+        fprintf(stderr, "Error rendering the animation, its first frame could not be read\n");
+        return RENDER_ERROR;
+    }
+    gdImagePtr previous = NULL;
+    gdImageGifAnimBegin(frame, output, 1, 0);
+
+    #pragma omp parallel num_threads(2) default(none) shared(output, frame_list, delay, map, frame, previous, status)
+    #pragma omp single
+    while(status == FRAME_READ){
+        gdImagePtr next;
+        enum frame_status next_status;
+        #pragma omp task default(none) shared(next, next_status, frame_list, map, frame)
+        next_status = read_frame(frame_list, map, frame, &next);
+
+        gdImageGifAnimAdd(frame, output, 0, 0, 0, delay, 1, previous);
+        #pragma omp taskwait
+
+        if(previous) gdImageDestroy(previous);
+        previous = frame;
+        frame = next;
+        status = next_status;
     }
+    gdImageDestroy(previous);
 
-    gdImageGifAnimEnd(output);
-    for(size_t i = 0; i < size; i++){
-        gdImageDestroy(imgs[i]);
+    if(status == FRAME_ERROR){
+        fprintf(stderr, "Error rendering the animation, it was stopped at the frame that could not be read\n");
+        return RENDER_ERROR;
     }
+    gdImageGifAnimEnd(output);
+    return 0;
 }
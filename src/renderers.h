@@ -5,5 +5,5 @@
 #include "fractal_render.h"
 #include "grids.h"
 
-void render_png(FILE* output, const renderer_params* params);
-void render_gif(FILE* output, const renderer_params* params);
+int render_png(FILE* output, const renderer_params* params);
+int render_gif(FILE* output, const renderer_params* params);
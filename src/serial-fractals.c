@@ -1,7 +1,95 @@
 #include "fractals.h"
 #include <math.h>
+#include <stdlib.h>
 #include "precision.h"
 #include "grids.h"
+#include "cpu_dispatch.h"
+#include "traversal.h"
+#include "perturbation.h"
+#include "fixed_point.h"
+
+/*
+ * Recursively subdivides a rectangle whose border has already been filled
+ */
+static void subdivide(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params){
+    tile_t children[2];
+    const size_t count = subdivide_rect(grid, coords, rect, kernel, params, children);
+    for(size_t i = 0; i < count; i++){
+        subdivide(grid, coords, children[i], kernel, params);
+    }
+}
+
+/*
+ * Fills a grid one tile at a time, or by subdivision if GEN_SUBDIVIDE is set
+ * With GEN_AUTO_PRECISION the kernel is swapped for the cheapest precision that resolves the grid, see precision_kernel
+ * Rows that mirror other rows under the symmetry of the fractal are copied after the tiles are filled, see mirror_grid_coords
+ */
+static void traverse_grid(grid_t* grid, const grid_gen_params* params, span_kernel kernel, const enum grid_symmetry symmetry){
+    bool offsets = row_kernels->offset_coordinates;
+    if(params->flags & GEN_AUTO_PRECISION){
+        kernel = precision_kernel(grid, params, kernel, &offsets);
+    }
+    grid_coords_t* coords = create_grid_coords(grid, offsets);
+    if(!coords) return;
+
+    // kernels with offset coordinates add them to the lower left corner of the grid, see create_grid_coords
+    grid_gen_params span_params = *params;
+    span_params.origin = grid->lower_left;
+    params = &span_params;
+
+    if(params->flags & GEN_SUBDIVIDE){
+        const tile_t whole = { .x = 0, .y = 0, .width = grid->x, .height = grid->y };
+        fill_border(grid, coords, whole, kernel, params);
+        subdivide(grid, coords, whole, kernel, params);
+    }
+    else {
+        // offsets from the lower left corner are not symmetric even when the grid is, and copied rows save no iteration state
+        const size_t mirrored = offsets || params->state ? 0 : mirror_grid_coords(coords, symmetry);
+        if(params->stats){
+            params->stats->mirrored_rows += mirrored;
+        }
+
+        const size_t tiles = tile_count(grid);
+        for(size_t i = 0; i < tiles; i++){
+            fill_tile(grid, coords, get_tile(grid, i), kernel, params);
+        }
+        if(mirrored){
+            for(size_t row = 0; row < grid->y; row++){
+                fill_mirrored_row(grid, coords, row, kernel, params);
+            }
+        }
+    }
+    free_grid_coords(coords);
+}
+
+/*
+ * Fills a grid by perturbation around high precision reference orbits, one row at a time
+ * Glitched points are perturbed again around a new reference until none are left, see perturbation.h
+ */
+static void perturbation_traverse(grid_t* grid, const grid_gen_params* params, const int degree, const bool conjugate){
+    perturbation_state* state = create_perturbation_state(grid, params, degree, conjugate);
+    if(!state) return;
+
+    do {
+        for(size_t row = 0; row < grid->y; row++){
+            perturb_row(state, row);
+        }
+    } while(next_reference(state));
+    free_perturbation_state(state);
+}
+
+/*
+ * Fills a grid with the fixed point kernels, one row at a time
+ */
+static void fixed_point_traverse(grid_t* grid, const grid_gen_params* params, const enum fixed_point_map map){
+    fixed_point_state* state = create_fixed_point_state(grid, params, map);
+    if(!state) return;
+
+    for(size_t row = 0; row < grid->y; row++){
+        fixed_point_row(state, row);
+    }
+    free_fixed_point_state(state);
+}
 
 /*
  * Computes the number of iterations it takes for a point z0 to become unbounded
@@ -23,13 +111,11 @@ byte mandelbrot(const CBASE complex z0, const byte max_iterations) {
  * Fills a grid with mandelbrot values
  */
 void mandelbrot_grid(grid_t* grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    for(size_t i = 0; i < size; i++){
-        data[i] = mandelbrot(grid_to_complex(grid, i), max_iterations);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, 2, false);
+        return;
     }
+    traverse_grid(grid, params, row_kernels->mandelbrot_row, REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -51,13 +137,11 @@ byte tricorn(const CBASE complex z0, const byte max_iterations){
  * Fills a grid with tricorn values
  */
 void tricorn_grid(grid_t* grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    for(size_t i = 0; i < size; i++){
-        data[i] = tricorn(grid_to_complex(grid, i), max_iterations);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, 2, true);
+        return;
     }
+    traverse_grid(grid, params, row_kernels->tricorn_row, REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -81,13 +165,7 @@ byte burning_ship(const CBASE complex z0, const byte max_iterations) {
  * Fills a grid with burning_ship values
  */
 void burning_ship_grid(grid_t* grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    for(size_t i = 0; i < size; i++){
-        data[i] = burning_ship(grid_to_complex(grid, i), max_iterations);
-    }
+    traverse_grid(grid, params, row_kernels->burning_ship_row, NO_SYMMETRY);
 }
 
 /*
@@ -110,13 +188,11 @@ byte multibrot(const CBASE complex z0, const byte max_iterations, const double d
  * Fills a grid with multibrot values
  */
 void multibrot_grid(grid_t* grid, const grid_gen_params* params){
-    const double d = params->degree;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-    for(size_t i = 0; i < size; i ++){
-        data[i] = multibrot(grid_to_complex(grid, i), max_iterations, d);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, params->degree, false);
+        return;
     }
+    traverse_grid(grid, params, power_kernel(params->degree, false), REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -138,13 +214,11 @@ byte multicorn(const CBASE complex z0, const byte max_iterations, const double d
  * Fills a grid with multicorn values
  */
 void multicorn_grid(grid_t* grid, const grid_gen_params* params){
-    const double d = params->degree;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-    for(size_t i = 0; i < size; i ++){
-        data[i] = multicorn(grid_to_complex(grid, i), max_iterations, d);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, params->degree, true);
+        return;
     }
+    traverse_grid(grid, params, power_kernel(params->degree, true), REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -165,13 +239,17 @@ byte julia(const CBASE complex z0, const CBASE complex c, const byte max_iterati
 }
 
 void julia_grid(grid_t* grid, const grid_gen_params* params){
-    const complex_t constant = params->cr.constant;
-    const double radius = params->cr.radius;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    const CBASE complex c = constant.re + constant.im * I;
-    byte* data = grid->data;
-    for(size_t i = 0; i <size; i++){
-        data[i] = julia(grid_to_complex(grid, i), c, max_iterations, radius);
-    }
+    traverse_grid(grid, params, row_kernels->julia_row, ORIGIN_SYMMETRY);
+}
+
+void mandelbrot_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_MANDELBROT);
+}
+
+void tricorn_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_TRICORN);
+}
+
+void burning_ship_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_BURNING_SHIP);
 }
@@ -2,8 +2,153 @@
 
 #include <omp.h>
 #include <math.h>
+#include <stdlib.h>
 #include "fractals.h"
 #include "precision.h"
+#include "cpu_dispatch.h"
+#include "traversal.h"
+#include "perturbation.h"
+#include "fixed_point.h"
+#include "work_stealing.h"
+#include "cost_plan.h"
+
+// a tile loop handed to the work stealing scheduler
+typedef struct {
+    grid_t* grid;
+    const grid_coords_t* coords;
+    span_kernel kernel;
+    const grid_gen_params* params;
+    // the work units of a GEN_COST_PLAN grid
+    cost_plan* plan;
+} tile_loop;
+
+static void fill_tile_task(const size_t index, void* context){
+    const tile_loop* loop = context;
+    fill_tile(loop->grid, loop->coords, get_tile(loop->grid, index), loop->kernel, loop->params);
+}
+
+static void fill_unit_task(const size_t index, void* context){
+    const tile_loop* loop = context;
+    const double start = omp_get_wtime();
+    fill_tile(loop->grid, loop->coords, loop->plan->units[index], loop->kernel, loop->params);
+    loop->plan->seconds[index] = omp_get_wtime() - start;
+}
+
+static void mirror_row_task(const size_t row, void* context){
+    const tile_loop* loop = context;
+    fill_mirrored_row(loop->grid, loop->coords, row, loop->kernel, loop->params);
+}
+
+static void perturb_row_task(const size_t row, void* state){
+    perturb_row(state, row);
+}
+
+static void fixed_point_row_task(const size_t row, void* state){
+    fixed_point_row(state, row);
+}
+
+/*
+ * Adds the steals of a scheduled loop to the stats of a grid
+ */
+static inline void add_steals(const grid_gen_params* params, const size_t steals){
+    if(params->stats){
+        params->stats->steals += steals;
+    }
+}
+
+/*
+ * Recursively subdivides a rectangle whose border has already been filled, each half becomes its own task
+ */
+static void subdivide(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params){
+    tile_t children[2];
+    const size_t count = subdivide_rect(grid, coords, rect, kernel, params, children);
+    for(size_t i = 0; i < count; i++){
+        const tile_t child = children[i];
+        #pragma omp task default(none) firstprivate(grid, coords, child, kernel, params)
+        subdivide(grid, coords, child, kernel, params);
+    }
+}
+
+/*
+ * Fills a grid by work stealing between threads that each start on a band of tiles, or by subdivision if GEN_SUBDIVIDE is set
+ * With GEN_COST_PLAN the tiles are first split and merged into units of equal predicted cost, see cost_plan.h
+ * With GEN_AUTO_PRECISION the kernel is swapped for the cheapest precision that resolves the grid, see precision_kernel
+ * Rows that mirror other rows under the symmetry of the fractal are copied after the tiles are filled, see mirror_grid_coords
+ */
+static void traverse_grid(grid_t* grid, const grid_gen_params* params, span_kernel kernel, const enum grid_symmetry symmetry){
+    bool offsets = row_kernels->offset_coordinates;
+    if(params->flags & GEN_AUTO_PRECISION){
+        kernel = precision_kernel(grid, params, kernel, &offsets);
+    }
+    grid_coords_t* coords = create_grid_coords(grid, offsets);
+    if(!coords) return;
+
+    // kernels with offset coordinates add them to the lower left corner of the grid, see create_grid_coords
+    grid_gen_params span_params = *params;
+    span_params.origin = grid->lower_left;
+    params = &span_params;
+
+    if(params->flags & GEN_SUBDIVIDE){
+        const tile_t whole = { .x = 0, .y = 0, .width = grid->x, .height = grid->y };
+        fill_border(grid, coords, whole, kernel, params);
+
+        #pragma omp parallel default(none) shared(grid, coords, whole, kernel, params)
+        #pragma omp single
+        subdivide(grid, coords, whole, kernel, params);
+    }
+    else {
+        // offsets from the lower left corner are not symmetric even when the grid is, and copied rows save no iteration state
+        const size_t mirrored = offsets || params->state ? 0 : mirror_grid_coords(coords, symmetry);
+        if(params->stats){
+            params->stats->mirrored_rows += mirrored;
+        }
+
+        tile_loop loop = { .grid = grid, .coords = coords, .kernel = kernel, .params = params, .plan = NULL };
+        if(params->flags & GEN_COST_PLAN){
+            loop.plan = create_cost_plan(grid, coords, kernel, params, omp_get_max_threads());
+        }
+
+        if(loop.plan){
+            add_steals(params, steal_tasks(loop.plan->count, fill_unit_task, &loop));
+            if(params->cost_map){
+                write_cost_map(params->cost_map, grid, loop.plan);
+            }
+            free_cost_plan(loop.plan);
+        }
+        else {
+            add_steals(params, steal_tasks(tile_count(grid), fill_tile_task, &loop));
+        }
+        if(mirrored){
+            add_steals(params, steal_tasks(grid->y, mirror_row_task, &loop));
+        }
+    }
+    free_grid_coords(coords);
+}
+
+/*
+ * Fills a grid by perturbation around high precision reference orbits, rows are perturbed in parallel by work stealing
+ * Glitched points are perturbed again around a new reference until none are left, see perturbation.h
+ */
+static void perturbation_traverse(grid_t* grid, const grid_gen_params* params, const int degree, const bool conjugate){
+    perturbation_state* state = create_perturbation_state(grid, params, degree, conjugate);
+    if(!state) return;
+
+    do {
+        add_steals(params, steal_tasks(grid->y, perturb_row_task, state));
+    } while(next_reference(state));
+    free_perturbation_state(state);
+}
+
+/*
+ * Fills a grid with the fixed point kernels, rows are filled in parallel by work stealing
+ */
+static void fixed_point_traverse(grid_t* grid, const grid_gen_params* params, const enum fixed_point_map map){
+    fixed_point_state* state = create_fixed_point_state(grid, params, map);
+    if(!state) return;
+
+    add_steals(params, steal_tasks(grid->y, fixed_point_row_task, state));
+    free_fixed_point_state(state);
+}
 
 /*
  * Computes the number of iterations it takes for a point z0 to diverge
@@ -25,14 +170,11 @@ byte mandelbrot(const CBASE complex z0, const byte max_iterations){
  * Fills a grid with mandelbrot values
  */
 void mandelbrot_grid(grid_t* restrict grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations) schedule(dynamic)
-    for(size_t i = 0; i < size; i++){
-        data[i] = mandelbrot(grid_to_complex(grid, i), max_iterations);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, 2, false);
+        return;
     }
+    traverse_grid(grid, params, row_kernels->mandelbrot_row, REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -54,14 +196,11 @@ byte tricorn(const CBASE complex z0, const byte max_iterations){
  * Fills a grid with tricorn values
  */
 void tricorn_grid(grid_t* grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations) schedule(dynamic)
-    for(size_t i = 0; i < size; i++){
-        data[i] = tricorn(grid_to_complex(grid, i), max_iterations);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, 2, true);
+        return;
     }
+    traverse_grid(grid, params, row_kernels->tricorn_row, REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -85,14 +224,7 @@ byte burning_ship(const CBASE complex z0, const byte max_iterations) {
  * Fills a grid with burning_ship values
  */
 void burning_ship_grid(grid_t* grid, const grid_gen_params* params){
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations) schedule(dynamic)
-    for(size_t i = 0; i < size; i++){
-        data[i] = burning_ship(grid_to_complex(grid, i), max_iterations);
-    }
+    traverse_grid(grid, params, row_kernels->burning_ship_row, NO_SYMMETRY);
 }
 
 /*
@@ -114,15 +246,11 @@ byte multibrot(const CBASE complex z0, const byte max_iterations, const double d
  * Fills a grid with multibrot values
  */
 void multibrot_grid(grid_t* restrict grid, const grid_gen_params* params){
-    const double d = params->degree;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations, d) schedule(dynamic)
-    for(size_t i = 0; i < size; i ++){
-        data[i] = multibrot(grid_to_complex(grid, i), max_iterations, d);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, params->degree, false);
+        return;
     }
+    traverse_grid(grid, params, power_kernel(params->degree, false), REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -144,14 +272,11 @@ byte multicorn(const CBASE complex z0, const byte max_iterations, const double d
  * Fills a grid with multicorn values
  */
 void multicorn_grid(grid_t* grid, const grid_gen_params* params){
-    const double d = params->degree;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    byte* data = grid->data;
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations, d) schedule(dynamic)
-    for(size_t i = 0; i < size; i ++){
-        data[i] = multicorn(grid_to_complex(grid, i), max_iterations, d);
+    if(params->flags & GEN_PERTURBATION){
+        perturbation_traverse(grid, params, params->degree, true);
+        return;
     }
+    traverse_grid(grid, params, power_kernel(params->degree, true), REAL_AXIS_SYMMETRY);
 }
 
 /*
@@ -173,14 +298,17 @@ byte julia(const CBASE complex z0, const CBASE complex c, const byte max_iterati
 }
 
 void julia_grid(grid_t* grid, const grid_gen_params* params){
-    const complex_t constant = params->cr.constant;
-    const double radius = params->cr.radius;
-    const size_t size = grid->size;
-    const byte max_iterations = grid->max_iterations;
-    const CBASE complex c = constant.re + constant.im * I;
-    byte* data = grid->data;
-    #pragma omp parallel for default(none) shared(data, size, grid, max_iterations, c, radius) schedule(dynamic)
-    for(size_t i = 0; i < size; i++){
-        data[i] = julia(grid_to_complex(grid, i), c, max_iterations, radius);
-    }
+    traverse_grid(grid, params, row_kernels->julia_row, ORIGIN_SYMMETRY);
+}
+
+void mandelbrot_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_MANDELBROT);
+}
+
+void tricorn_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_TRICORN);
+}
+
+void burning_ship_fixed_grid(grid_t* grid, const grid_gen_params* params){
+    fixed_point_traverse(grid, params, FIXED_BURNING_SHIP);
 }
@@ -0,0 +1,1046 @@
+/*
+ * Row span versions of the escape time algorithms
+ *
+ * Each span is split into groups of VEC_WIDTH points which are iterated together until every point in the
+ * group has escaped (or max_iterations is reached). Points that escape are retired from their group by
+ * clearing their lane in the group's alive mask, which also stops their iteration count.
+ *
+ * Besides the kernels of the build precision, the file is compiled into float kernels (FLOAT_KERNELS) with twice the points
+ * per vector, and long double kernels (EXTENDED_KERNELS) that take their coordinates as offsets, see precision_kernel in cpu_dispatch.c
+ */
+#include <complex.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <immintrin.h>
+#include "simd_kernels.h"
+
+#if defined(FLOAT_KERNELS) && defined(EXTENDED_KERNELS)
+#error FLOAT_KERNELS and EXTENDED_KERNELS can not be combined
+#endif
+
+// the points are iterated in double-double lanes
+#if defined(DOUBLE_DOUBLE_PRECISION) && !defined(FLOAT_KERNELS) && !defined(EXTENDED_KERNELS)
+#define DOUBLE_DOUBLE_LANES
+#endif
+
+// the name of the instruction set this file is being compiled for, set by the makefile
+#ifndef KERNEL_ISA
+#define KERNEL_ISA sse2
+#endif
+
+#define CONCAT_(a, b) a ## b
+#define CONCAT(a, b) CONCAT_(a, b)
+#define STRINGIFY_(a) #a
+#define STRINGIFY(a) STRINGIFY_(a)
+
+// the type the points are iterated in, the coordinates are handed to the kernels as CBASE
+#if defined(FLOAT_KERNELS)
+#define KREAL float
+#define KCABS cabsf
+#define KCPOW cpowf
+#define KCONJ conjf
+#define KCREAL crealf
+#define KCIMAG cimagf
+#define KRABS fabsf
+#define KEPSILON FLT_EPSILON
+#define KERNEL_PRECISION "float"
+#define KERNEL_PRECISION_BITS FLT_MANT_DIG
+#define KERNEL_TABLE CONCAT(float_kernels_, KERNEL_ISA)
+#elif defined(EXTENDED_KERNELS)
+#define KREAL long double
+#define KCABS cabsl
+#define KCPOW cpowl
+#define KCONJ conjl
+#define KCREAL creall
+#define KCIMAG cimagl
+#define KRABS fabsl
+#define KEPSILON LDBL_EPSILON
+#define KERNEL_PRECISION "long double"
+#define KERNEL_PRECISION_BITS LDBL_MANT_DIG
+#define KERNEL_TABLE extended_kernels
+#else
+#define KREAL CBASE
+#define KCABS CABS
+#define KCPOW CPOW
+#define KCONJ CONJ
+#define KCREAL CREAL
+#define KCIMAG CIMAG
+#define KRABS RABS
+#define KEPSILON CEPSILON
+#ifdef DOUBLE_DOUBLE_LANES
+#define KERNEL_PRECISION "double-double"
+#define KERNEL_PRECISION_BITS (2 * DBL_MANT_DIG)
+#elif defined(EXTENDED_PRECISION)
+#define KERNEL_PRECISION "long double"
+#define KERNEL_PRECISION_BITS LDBL_MANT_DIG
+#else
+#define KERNEL_PRECISION "double"
+#define KERNEL_PRECISION_BITS DBL_MANT_DIG
+#endif
+#define KERNEL_TABLE CONCAT(simd_kernels_, KERNEL_ISA)
+#endif
+
+// the number of points that are evaluated in lockstep
+#if (defined(EXTENDED_PRECISION) && !defined(FLOAT_KERNELS)) || defined(EXTENDED_KERNELS)
+#define VEC_WIDTH 1
+#elif defined(FLOAT_KERNELS) && defined(__AVX512F__)
+#define VEC_WIDTH 16
+#elif defined(FLOAT_KERNELS) && defined(__AVX__)
+#define VEC_WIDTH 8
+#elif defined(FLOAT_KERNELS)
+#define VEC_WIDTH 4
+#elif defined(__AVX512F__)
+#define VEC_WIDTH 8
+#elif defined(__AVX__)
+#define VEC_WIDTH 4
+#else
+#define VEC_WIDTH 2
+#endif
+
+// CYCLE_TOLERANCE scaled to the precision of the lanes
+#if defined(FLOAT_KERNELS) || defined(EXTENDED_KERNELS)
+#define LANE_CYCLE_TOLERANCE ((KREAL)(CYCLE_TOLERANCE / CEPSILON * KEPSILON))
+#else
+#define LANE_CYCLE_TOLERANCE CYCLE_TOLERANCE
+#endif
+
+enum escape_map {
+    MAP_MANDELBROT,
+    MAP_TRICORN,
+    MAP_BURNING_SHIP,
+    MAP_MULTIBROT,
+    MAP_MULTICORN,
+    MAP_MULTIBROT_POLAR,
+    MAP_MULTICORN_POLAR,
+    MAP_JULIA
+};
+
+// the settings shared by every point in a span
+typedef struct {
+    enum escape_map map;
+    int degree;
+    double exponent;
+    complex_t c;
+    double R;
+    bool interior_check;
+    bool cycle_check;
+    byte max_iterations;
+    // the point the coordinates of the span are offsets from, when they are offsets
+    complex_t origin;
+    // the state the points are saved to and continued from, only the vectorized kernels without offsets keep one
+    iteration_state* state;
+    // the index in the grid of the first point handed to escape_lanes
+    size_t first_point;
+} escape_settings;
+
+// the coordinates of a span are offsets from its origin in double-double builds and in the extended kernels, see create_grid_coords
+#if defined(DOUBLE_DOUBLE_PRECISION) || defined(EXTENDED_KERNELS)
+#define OFFSET_COORDINATES 1
+#else
+#define OFFSET_COORDINATES 0
+#endif
+
+// the absolute coordinate of a point in a span
+#if OFFSET_COORDINATES
+#define SPAN_COORD(origin, offset) ((KREAL)(origin) + (offset))
+#else
+#define SPAN_COORD(origin, offset) (offset)
+#endif
+
+/*
+ * Checks if two points of an orbit are close enough to be considered the same point
+ */
+static inline bool same_orbit_point(const KREAL x1, const KREAL y1, const KREAL x2, const KREAL y2){
+    return KRABS(x1 - x2) < LANE_CYCLE_TOLERANCE && KRABS(y1 - y2) < LANE_CYCLE_TOLERANCE;
+}
+
+#if VEC_WIDTH == 1
+
+// julia sets are iterated in double like the scalar julia kernel, except by the extended kernels
+#ifdef EXTENDED_KERNELS
+#define JULIA_REAL KREAL
+#else
+#define JULIA_REAL double
+#endif
+
+/*
+ * Raises z to a positive integer power by binary exponentiation
+ */
+static inline KREAL complex complex_power(const KREAL complex z, const int degree){
+    KREAL complex power = z;
+    for(int bit = 30 - __builtin_clz(degree); bit >= 0; bit--){
+        power = power * power;
+        if(degree >> bit & 1) power = power * z;
+    }
+    return power;
+}
+
+/*
+ * Scalar fallback for precisions that can not be held in vector registers,
+ * mirrors the scalar kernels exactly
+ *
+ * With cycle_check set the orbit is compared against a saved point which is replaced at every power of 2 iterations (Brent's method),
+ * if the orbit returns to the saved point it is periodic and will never escape
+ */
+static inline byte escape_point(const KREAL x0, const KREAL y0, const escape_settings settings){
+    const KREAL complex z0 = x0 + y0 * I;
+    const byte max_iterations = settings.max_iterations;
+    size_t next_save = 1;
+    byte iteration = 0;
+
+    if(settings.map == MAP_JULIA){
+        const KREAL complex c_z = settings.c.re + settings.c.im * I;
+        JULIA_REAL complex z = z0;
+        JULIA_REAL complex saved = z0;
+        while(KCABS(z) < settings.R && iteration < max_iterations){
+            z = z * z + c_z;
+            iteration++;
+            if(settings.cycle_check){
+                if(same_orbit_point(KCREAL(z), KCIMAG(z), KCREAL(saved), KCIMAG(saved))) return max_iterations;
+                if(iteration == next_save){
+                    saved = z;
+                    next_save *= 2;
+                }
+            }
+        }
+        return iteration;
+    }
+
+    KREAL complex z = z0;
+    KREAL complex z_mod;
+    KREAL complex saved = z0;
+    while(KCABS(z) <= 2 && iteration < max_iterations){
+        switch(settings.map){
+            case MAP_TRICORN:
+                z = KCONJ(z * z) + z0;
+                break;
+            case MAP_BURNING_SHIP:
+                z_mod = KRABS(KCREAL(z)) + KRABS(KCIMAG(z))*I;
+                z = z_mod * z_mod + z0;
+                break;
+            case MAP_MULTIBROT:
+                z = complex_power(z, settings.degree) + z0;
+                break;
+            case MAP_MULTICORN:
+                z = KCONJ(complex_power(z, settings.degree)) + z0;
+                break;
+            default:
+                z = z * z + z0;
+                break;
+        }
+        iteration++;
+        if(settings.cycle_check){
+            if(same_orbit_point(KCREAL(z), KCIMAG(z), KCREAL(saved), KCIMAG(saved))) return max_iterations;
+            if(iteration == next_save){
+                saved = z;
+                next_save *= 2;
+            }
+        }
+    }
+    return iteration;
+}
+
+/*
+ * Fills a span of points
+ * Returns the number of points that were found by the interior check
+ */
+static inline size_t escape_span(byte* out, const CBASE* re, const CBASE im, const size_t n, const escape_settings settings){
+    const KREAL y = SPAN_COORD(settings.origin.im, im);
+    size_t interior = 0;
+    for(size_t i = 0; i < n; i++){
+        const KREAL x = SPAN_COORD(settings.origin.re, re[i]);
+        if(settings.interior_check && in_mandelbrot_interior(x, y)){
+            out[i] = settings.max_iterations;
+            interior++;
+        }
+        else {
+            out[i] = escape_point(x, y, settings);
+        }
+    }
+    return interior;
+}
+
+#else
+
+// the masks and integers of the lanes have the width of a lane
+#ifdef FLOAT_KERNELS
+typedef int lane_int;
+#else
+typedef long long lane_int;
+#endif
+
+typedef KREAL vreal __attribute__((vector_size(VEC_WIDTH * sizeof(KREAL))));
+typedef lane_int vmask __attribute__((vector_size(VEC_WIDTH * sizeof(lane_int))));
+typedef lane_int vint __attribute__((vector_size(VEC_WIDTH * sizeof(lane_int))));
+
+// relative width of the band around the escape radius where |z|^2 can not be trusted to agree with CABS
+#ifdef FLOAT_KERNELS
+#define RADIUS_TOLERANCE 0x1p-20
+#else
+#define RADIUS_TOLERANCE 0x1p-40
+#endif
+
+/*
+ * Checks if any lane of a mask is set with a single test of the whole register
+ */
+static inline bool any_lane(const vmask mask){
+#if defined(__AVX512F__)
+    return _mm512_test_epi64_mask((__m512i)mask, (__m512i)mask) != 0;
+#elif defined(__AVX__)
+    return !_mm256_testz_si256((__m256i)mask, (__m256i)mask);
+#else
+    return _mm_movemask_epi8((__m128i)mask) != 0;
+#endif
+}
+
+static inline vreal splat(const KREAL value){
+    vreal v;
+    for(int i = 0; i < VEC_WIDTH; i++){
+        v[i] = value;
+    }
+    return v;
+}
+
+static inline vreal vabs(const vreal v){
+    const vmask sign_bit = ((vmask){0} + 1) << (8 * sizeof(lane_int) - 1);
+    return (vreal)((vmask)v & ~sign_bit);
+}
+
+/*
+ * Raises the points x + yi to a positive integer power by binary exponentiation, storing the result in re and im
+ * When inlined with a constant degree the loop is fully unrolled
+ */
+static inline void complex_power_lanes(vreal* re, vreal* im, const vreal x, const vreal y, const int degree){
+    vreal power_x = x;
+    vreal power_y = y;
+    for(int bit = 30 - __builtin_clz(degree); bit >= 0; bit--){
+        const vreal xy = power_x * power_y;
+        power_x = power_x * power_x - power_y * power_y;
+        power_y = xy + xy;
+        if(degree >> bit & 1){
+            const vreal next_x = power_x * x - power_y * y;
+            power_y = power_x * y + power_y * x;
+            power_x = next_x;
+        }
+    }
+    *re = power_x;
+    *im = power_y;
+}
+
+static inline vreal select_lanes(const vmask mask, const vreal a, const vreal b){
+    return (vreal)(((vmask)a & mask) | ((vmask)b & ~mask));
+}
+
+// the polar maps are evaluated with the bit layout of a double, the float kernels leave them to the double kernels
+#ifndef FLOAT_KERNELS
+
+// adding and subtracting this rounds a double with a magnitude below 2^51 to the nearest integer, which is left in the low bits
+#define ROUNDING_SHIFTER 0x1.8p52
+
+static inline vreal int_to_real(const vint v){
+    return (vreal)(v + (vint)splat(ROUNDING_SHIFTER)) - ROUNDING_SHIFTER;
+}
+
+/*
+ * Natural logarithm of positive lanes, within a few ulp of log
+ * The argument is split into 2^e * m with m in [sqrt(2)/2, sqrt(2)), and log(m) = 2 atanh((m - 1) / (m + 1)) is summed as a series
+ */
+static inline vreal log_lanes(vreal v){
+    const vmask subnormal = v < 0x1p-1022;
+    v = select_lanes(subnormal, v * 0x1p108, v);
+
+    const vint bits = (vint)v;
+    vint exponent = ((bits >> 52) & 0x7ff) - 1023 - (subnormal & 108);
+    vreal m = (vreal)((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+    const vmask large = m > M_SQRT2;
+    m = select_lanes(large, m * 0.5, m);
+    exponent -= large;
+
+    const vreal f = (m - 1) / (m + 1);
+    const vreal f2 = f * f;
+    vreal series = splat(2.0 / 21);
+    for(int k = 19; k >= 1; k -= 2){
+        series = series * f2 + 2.0 / k;
+    }
+    const vreal e = int_to_real(exponent);
+    return e * 0x1.62e42fefa3800p-1 + (f * series + e * 0x1.ef35793c76730p-45);
+}
+
+/*
+ * e^v within a few ulp of exp, using the Pade approximation from the Cephes library after reducing v by multiples of log(2)
+ * v is clamped to the range where the result is a normal double
+ */
+static inline vreal exp_lanes(vreal v){
+    v = select_lanes(v > 709, splat(709), v);
+    v = select_lanes(v < -708, splat(-708), v);
+
+    const vreal shifted = v * M_LOG2E + ROUNDING_SHIFTER;
+    const vreal n = shifted - ROUNDING_SHIFTER;
+    const vreal r = (v - n * 6.93145751953125e-1) - n * 1.42860682030941723212e-6;
+    const vreal r2 = r * r;
+    const vreal p = r * ((1.26177193074810590878e-4 * r2 + 3.02994407707441961300e-2) * r2 + 9.99999999999999999910e-1);
+    const vreal q = ((3.00198505138664455042e-6 * r2 + 2.52448340349684104192e-3) * r2 + 2.27265548208155028766e-1) * r2 + 2.00000000000000000009e0;
+    const vreal power = (vreal)(((vint)shifted - (vint)splat(ROUNDING_SHIFTER) + 1023) << 52);
+    return (1 + 2 * (p / (q - p))) * power;
+}
+
+/*
+ * Sine and cosine of the lanes, within a few ulp of sin and cos for arguments well below 2^30
+ * The argument is reduced by multiples of pi/2 and evaluated with the polynomials from fdlibm
+ */
+static inline void sincos_lanes(vreal* sine, vreal* cosine, const vreal v){
+    const vreal shifted = v * M_2_PI + ROUNDING_SHIFTER;
+    const vreal k = shifted - ROUNDING_SHIFTER;
+    const vreal r = ((v - k * 1.57079632673412561417e+00) - k * 6.07710050630396597660e-11) - k * 2.02226624879595063154e-21;
+    const vreal z = r * r;
+
+    const vreal s = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04
+        + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    const vreal c = 1 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05
+        + z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+
+    // rotate by the quadrant that was removed
+    const vint quadrant = (vint)shifted;
+    const vmask swap = (quadrant & 1) != 0;
+    const vmask sign_bit = ((vmask){0} + 1) << 63;
+    const vmask sine_sign = (quadrant & 2) << 62;
+    const vmask cosine_sign = ((quadrant + 1) & 2) << 62;
+    *sine = (vreal)((vmask)select_lanes(swap, c, s) ^ (sine_sign & sign_bit));
+    *cosine = (vreal)((vmask)select_lanes(swap, s, c) ^ (cosine_sign & sign_bit));
+}
+
+/*
+ * The angle of the points x + yi in (-pi, pi] like atan2, within a few ulp
+ * The ratio of the smaller to the larger coordinate is evaluated with the rational approximation of atan from the Cephes library
+ */
+static inline vreal atan2_lanes(const vreal y, const vreal x){
+    const vmask sign_bit = ((vmask){0} + 1) << 63;
+    const vreal ax = vabs(x);
+    const vreal ay = vabs(y);
+    const vmask steep = ay > ax;
+    const vreal larger = select_lanes(steep, ay, ax);
+    const vreal t = select_lanes(larger == 0, splat(0), select_lanes(steep, ax, ay) / larger);
+
+    // atan(t) = pi/4 + atan((t - 1) / (t + 1)) keeps the rational approximation within [0, 0.66]
+    const vmask reduce = t > 0.66;
+    const vreal u = select_lanes(reduce, (t - 1) / (t + 1), t);
+    const vreal u2 = u * u;
+    const vreal p = (((-8.750608600031904122785e-1 * u2 - 1.615753718733365076637e1) * u2 - 7.500855792314704667340e1) * u2
+        - 1.228866684490136173410e2) * u2 - 6.485021904942025371773e1;
+    const vreal q = ((((u2 + 2.485846490142306297962e1) * u2 + 1.650270098316988542046e2) * u2 + 4.328810604912902668951e2) * u2
+        + 4.853903996359136964868e2) * u2 + 1.945506571482613964425e2;
+    vreal angle = u * u2 * p / q + u;
+    angle = select_lanes(reduce, angle + (M_PI_4 + 0.5 * 6.123233995736765886130e-17), angle);
+
+    angle = select_lanes(steep, (M_PI_2 + 6.123233995736765886130e-17) - angle, angle);
+    angle = select_lanes((vmask)x < 0, (M_PI + 2 * 6.123233995736765886130e-17) - angle, angle);
+    return (vreal)((vmask)angle | ((vmask)y & sign_bit));
+}
+
+/*
+ * Raises the points x + yi to a real power on the principal branch like cpow, storing the result in re and im
+ * norm is |z|^2, z^d = e^(d log|z|) (cos(d arg z) + i sin(d arg z))
+ */
+static inline void polar_power_lanes(vreal* re, vreal* im, const vreal x, const vreal y, const vreal norm, const double exponent){
+    const vreal magnitude = select_lanes(norm == 0, splat(0), exp_lanes(0.5 * exponent * log_lanes(norm)));
+    vreal sine, cosine;
+    sincos_lanes(&sine, &cosine, exponent * atan2_lanes(y, x));
+    *re = magnitude * cosine;
+    *im = magnitude * sine;
+}
+
+#endif
+
+/*
+ * Vector version of in_mandelbrot_interior
+ */
+static inline vmask in_mandelbrot_interior_lanes(const vreal x, const vreal y){
+    const vreal y2 = y * y;
+    const vreal x_shift = x - 0.25;
+    const vreal q = x_shift * x_shift + y2;
+    const vreal x_bulb = x + 1;
+    return (q * (q + x_shift) < 0.25 * y2) | (x_bulb * x_bulb + y2 < 0.0625);
+}
+
+/*
+ * Computes the escape test with the same rounding as the scalar kernels
+ * This is only needed for points whose squared magnitude lies within rounding error of the escape radius
+ */
+static inline bool within_radius(const CBASE x, const CBASE y, const enum escape_map map, const double R){
+    if(map == MAP_JULIA){
+        return CABS(x + y * I) < R;
+    }
+    return CABS(x + y * I) <= 2;
+}
+
+/*
+ * Iterates VEC_WIDTH points in lockstep, storing the iteration counts of the first lanes points
+ * If interior_check is set, points inside the main cardioid or period 2 bulb are not iterated
+ * If cycle_check is set, points whose orbit returns to a point saved at a power of 2 iterations are retired with max_iterations
+ *
+ * Returns the number of stored points that were found by the interior check
+ */
+static inline size_t escape_lanes(byte* out, const vreal x0, const vreal y0, const size_t lanes, const escape_settings settings){
+    const enum escape_map map = settings.map;
+    const byte max_iterations = settings.max_iterations;
+    const KREAL bound = map == MAP_JULIA ? settings.R * settings.R : 4;
+    const KREAL bound_low = bound * (1 - RADIUS_TOLERANCE);
+    const KREAL bound_high = bound * (1 + RADIUS_TOLERANCE);
+    const vreal add_re = map == MAP_JULIA ? splat(settings.c.re) : x0;
+    const vreal add_im = map == MAP_JULIA ? splat(settings.c.im) : y0;
+
+    vreal x = x0;
+    vreal y = y0;
+    vreal saved_x = x0;
+    vreal saved_y = y0;
+    size_t next_save = 1;
+    vmask alive = (vmask){0} - 1;
+    vmask count = {0};
+    size_t interior = 0;
+    byte first_iteration = 0;
+
+    // points that had not escaped continue from their saved z, the others keep their iterations
+    iteration_state* state = settings.state;
+    if(state && state->resume){
+        const size_t first = settings.first_point;
+        for(int i = 0; i < VEC_WIDTH; i++){
+            if((size_t)i < lanes && out[i] == state->iterations){
+                x[i] = state->re[first + i];
+                y[i] = state->im[first + i];
+                count[i] = state->iterations;
+            }
+            else {
+                alive[i] = 0;
+                count[i] = (size_t)i < lanes ? out[i] : 0;
+            }
+        }
+        first_iteration = state->iterations;
+    }
+
+    if(settings.interior_check){
+        const vmask in_set = in_mandelbrot_interior_lanes(x0, y0);
+        alive &= ~in_set;
+        count = (count & ~in_set) | (in_set & max_iterations);
+        for(size_t i = 0; i < lanes; i++){
+            interior += in_set[i] != 0;
+        }
+    }
+
+    for(byte iteration = first_iteration; iteration < max_iterations; iteration++){
+        const vreal xx = x * x;
+        const vreal yy = y * y;
+        const vreal norm = xx + yy;
+
+        vmask inside = map == MAP_JULIA ? norm < bound : norm <= bound;
+        const vmask unsure = alive & (norm >= bound_low) & (norm <= bound_high);
+        if(any_lane(unsure)){
+            for(int i = 0; i < VEC_WIDTH; i++){
+                if(unsure[i]) inside[i] = within_radius(x[i], y[i], map, settings.R) ? -1 : 0;
+            }
+        }
+
+        alive &= inside;
+        if(!any_lane(alive)) break;
+        count -= alive;
+
+        const vreal xy = x * y;
+        vreal power_x, power_y;
+        switch(map){
+            case MAP_TRICORN:
+                x = xx - yy + add_re;
+                y = add_im - (xy + xy);
+                break;
+            case MAP_BURNING_SHIP:
+                x = xx - yy + add_re;
+                y = vabs(xy) + vabs(xy) + add_im;
+                break;
+            case MAP_MULTIBROT:
+                complex_power_lanes(&power_x, &power_y, x, y, settings.degree);
+                x = power_x + add_re;
+                y = power_y + add_im;
+                break;
+            case MAP_MULTICORN:
+                complex_power_lanes(&power_x, &power_y, x, y, settings.degree);
+                x = power_x + add_re;
+                y = add_im - power_y;
+                break;
+#ifndef FLOAT_KERNELS
+            case MAP_MULTIBROT_POLAR:
+                polar_power_lanes(&power_x, &power_y, x, y, norm, settings.exponent);
+                x = power_x + add_re;
+                y = power_y + add_im;
+                break;
+            case MAP_MULTICORN_POLAR:
+                // the conjugate negates the angle of z^d
+                polar_power_lanes(&power_x, &power_y, x, y, norm, settings.exponent);
+                x = power_x + add_re;
+                y = add_im - power_y;
+                break;
+#endif
+            default:
+                x = xx - yy + add_re;
+                y = xy + xy + add_im;
+                break;
+        }
+
+        if(settings.cycle_check){
+            const vmask cycled = alive & (vabs(x - saved_x) < LANE_CYCLE_TOLERANCE) & (vabs(y - saved_y) < LANE_CYCLE_TOLERANCE);
+            count = (count & ~cycled) | (cycled & max_iterations);
+            alive &= ~cycled;
+            if(iteration + 1u == next_save){
+                saved_x = x;
+                saved_y = y;
+                next_save *= 2;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < lanes; i++){
+        out[i] = count[i];
+    }
+    if(state){
+        for(size_t i = 0; i < lanes; i++){
+            state->re[settings.first_point + i] = x[i];
+            state->im[settings.first_point + i] = y[i];
+        }
+    }
+    return interior;
+}
+
+#ifdef DOUBLE_DOUBLE_LANES
+
+/*
+ * Double-double lanes, see double_double.h for the scalar versions of the operations
+ */
+typedef struct {
+    vreal hi;
+    vreal lo;
+} vdd;
+
+static inline vdd two_sum_lanes(const vreal a, const vreal b){
+    const vreal s = a + b;
+    const vreal b_virtual = s - a;
+    return (vdd){ s, (a - (s - b_virtual)) + (b - b_virtual) };
+}
+
+static inline vdd quick_two_sum_lanes(const vreal a, const vreal b){
+    const vreal s = a + b;
+    return (vdd){ s, b - (s - a) };
+}
+
+/*
+ * The rounding error of the product p = a * b, with a fused multiply subtract where the instruction set has one
+ */
+static inline vreal product_error(const vreal a, const vreal b, const vreal p){
+#if defined(__AVX512F__) && VEC_WIDTH == 8
+    return (vreal)_mm512_fmsub_pd((__m512d)a, (__m512d)b, (__m512d)p);
+#elif defined(__FMA__) && VEC_WIDTH == 4
+    return (vreal)_mm256_fmsub_pd((__m256d)a, (__m256d)b, (__m256d)p);
+#else
+    const vreal a_split = 134217729.0 * a;
+    const vreal a_hi = a_split - (a_split - a);
+    const vreal a_lo = a - a_hi;
+    const vreal b_split = 134217729.0 * b;
+    const vreal b_hi = b_split - (b_split - b);
+    const vreal b_lo = b - b_hi;
+    return ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+}
+
+static inline vdd add_lanes(const vdd a, const vdd b){
+    const vdd s = two_sum_lanes(a.hi, b.hi);
+    const vdd t = two_sum_lanes(a.lo, b.lo);
+    const vdd result = quick_two_sum_lanes(s.hi, s.lo + t.hi);
+    return quick_two_sum_lanes(result.hi, result.lo + t.lo);
+}
+
+static inline vdd sub_lanes(const vdd a, const vdd b){
+    return add_lanes(a, (vdd){ -b.hi, -b.lo });
+}
+
+static inline vdd mul_lanes(const vdd a, const vdd b){
+    const vreal p = a.hi * b.hi;
+    const vreal err = product_error(a.hi, b.hi, p) + (a.hi * b.lo + a.lo * b.hi);
+    return quick_two_sum_lanes(p, err);
+}
+
+static inline vdd sqr_lanes(const vdd a){
+    const vreal p = a.hi * a.hi;
+    const vreal err = product_error(a.hi, a.hi, p) + 2 * a.hi * a.lo;
+    return quick_two_sum_lanes(p, err);
+}
+
+static inline vdd twice_lanes(const vdd a){
+    return (vdd){ a.hi + a.hi, a.lo + a.lo };
+}
+
+static inline vdd abs_lanes(const vdd a){
+    const vmask negative = (vmask)a.hi < 0;
+    return (vdd){ vabs(a.hi), (vreal)((vmask)a.lo ^ (negative & ((vmask){0} + 1) << 63)) };
+}
+
+/*
+ * The double-double sum of a scalar double-double and the lanes of offset
+ */
+static inline vdd offset_lanes(const CBASE hi, const CBASE lo, const vreal offset){
+    const vdd s = two_sum_lanes(splat(hi), offset);
+    return quick_two_sum_lanes(s.hi, s.lo + lo);
+}
+
+/*
+ * Double-double version of complex_power_lanes
+ */
+static inline void complex_power_dd_lanes(vdd* re, vdd* im, const vdd x, const vdd y, const int degree){
+    vdd power_x = x;
+    vdd power_y = y;
+    for(int bit = 30 - __builtin_clz(degree); bit >= 0; bit--){
+        const vdd xy = mul_lanes(power_x, power_y);
+        power_x = sub_lanes(sqr_lanes(power_x), sqr_lanes(power_y));
+        power_y = twice_lanes(xy);
+        if(degree >> bit & 1){
+            const vdd next_x = sub_lanes(mul_lanes(power_x, x), mul_lanes(power_y, y));
+            power_y = add_lanes(mul_lanes(power_x, y), mul_lanes(power_y, x));
+            power_x = next_x;
+        }
+    }
+    *re = power_x;
+    *im = power_y;
+}
+
+/*
+ * Double-double version of escape_lanes for the maps that are iterated by multiplication
+ * The escape test only needs the high parts, the iteration counts match escape_lanes wherever double has enough precision
+ */
+static inline size_t escape_dd_lanes(byte* out, const vdd x0, const vdd y0, const size_t lanes, const escape_settings settings){
+    const enum escape_map map = settings.map;
+    const byte max_iterations = settings.max_iterations;
+    const CBASE bound = map == MAP_JULIA ? settings.R * settings.R : 4;
+    const CBASE bound_low = bound * (1 - RADIUS_TOLERANCE);
+    const CBASE bound_high = bound * (1 + RADIUS_TOLERANCE);
+    const vdd add_re = map == MAP_JULIA ? (vdd){ splat(settings.c.re), splat(settings.c.re_lo) } : x0;
+    const vdd add_im = map == MAP_JULIA ? (vdd){ splat(settings.c.im), splat(settings.c.im_lo) } : y0;
+
+    vdd x = x0;
+    vdd y = y0;
+    vdd saved_x = x0;
+    vdd saved_y = y0;
+    size_t next_save = 1;
+    vmask alive = (vmask){0} - 1;
+    vmask count = {0};
+    size_t interior = 0;
+
+    if(settings.interior_check){
+        const vmask in_set = in_mandelbrot_interior_lanes(x0.hi, y0.hi);
+        alive &= ~in_set;
+        count = in_set & max_iterations;
+        for(size_t i = 0; i < lanes; i++){
+            interior += in_set[i] != 0;
+        }
+    }
+
+    for(byte iteration = 0; iteration < max_iterations; iteration++){
+        const vdd xx = sqr_lanes(x);
+        const vdd yy = sqr_lanes(y);
+        const vreal norm = xx.hi + yy.hi;
+
+        vmask inside = map == MAP_JULIA ? norm < bound : norm <= bound;
+        const vmask unsure = alive & (norm >= bound_low) & (norm <= bound_high);
+        if(any_lane(unsure)){
+            for(int i = 0; i < VEC_WIDTH; i++){
+                if(unsure[i]) inside[i] = within_radius(x.hi[i], y.hi[i], map, settings.R) ? -1 : 0;
+            }
+        }
+
+        alive &= inside;
+        if(!any_lane(alive)) break;
+        count -= alive;
+
+        const vdd xy = mul_lanes(x, y);
+        vdd power_x, power_y;
+        switch(map){
+            case MAP_TRICORN:
+                x = add_lanes(sub_lanes(xx, yy), add_re);
+                y = sub_lanes(add_im, twice_lanes(xy));
+                break;
+            case MAP_BURNING_SHIP:
+                x = add_lanes(sub_lanes(xx, yy), add_re);
+                y = add_lanes(twice_lanes(abs_lanes(xy)), add_im);
+                break;
+            case MAP_MULTIBROT:
+                complex_power_dd_lanes(&power_x, &power_y, x, y, settings.degree);
+                x = add_lanes(power_x, add_re);
+                y = add_lanes(power_y, add_im);
+                break;
+            case MAP_MULTICORN:
+                complex_power_dd_lanes(&power_x, &power_y, x, y, settings.degree);
+                x = add_lanes(power_x, add_re);
+                y = sub_lanes(add_im, power_y);
+                break;
+            default:
+                x = add_lanes(sub_lanes(xx, yy), add_re);
+                y = add_lanes(twice_lanes(xy), add_im);
+                break;
+        }
+
+        if(settings.cycle_check){
+            const vmask cycled = alive & (vabs(sub_lanes(x, saved_x).hi) < CYCLE_TOLERANCE) & (vabs(sub_lanes(y, saved_y).hi) < CYCLE_TOLERANCE);
+            count = (count & ~cycled) | (cycled & max_iterations);
+            alive &= ~cycled;
+            if(iteration + 1u == next_save){
+                saved_x = x;
+                saved_y = y;
+                next_save *= 2;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < lanes; i++){
+        out[i] = count[i];
+    }
+    return interior;
+}
+
+/*
+ * Iterates VEC_WIDTH points at the origin of the span plus the offsets x0 and y0
+ * Polar maps have no double-double version, they are iterated in double from the high parts
+ */
+static inline size_t escape_offset_lanes(byte* out, const vreal x0, const vreal y0, const size_t lanes, const escape_settings settings){
+    const vdd x = offset_lanes(settings.origin.re, settings.origin.re_lo, x0);
+    const vdd y = offset_lanes(settings.origin.im, settings.origin.im_lo, y0);
+    if(settings.map == MAP_MULTIBROT_POLAR || settings.map == MAP_MULTICORN_POLAR){
+        return escape_lanes(out, x.hi, y.hi, lanes, settings);
+    }
+    return escape_dd_lanes(out, x, y, lanes, settings);
+}
+
+// the double-double lanes add the origin themselves
+#define ESCAPE_LANES escape_offset_lanes
+#define LANE_COORD(origin, offset) (offset)
+#else
+#define ESCAPE_LANES escape_lanes
+#define LANE_COORD(origin, offset) SPAN_COORD(origin, offset)
+#endif
+
+/*
+ * Fills a span of points
+ * Returns the number of points that were found by the interior check
+ */
+static inline size_t escape_span(byte* out, const CBASE* re, const CBASE im, const size_t n, const escape_settings settings){
+    const vreal y0 = splat(LANE_COORD(settings.origin.im, im));
+    vreal x0 = {0};
+    size_t interior = 0;
+    // the lanes find their points in the state by the offset of the span into the grid
+    escape_settings group = settings;
+    const size_t first_point = settings.state ? (size_t)(out - settings.state->data) : 0;
+
+    size_t i = 0;
+    for(; i + VEC_WIDTH <= n; i += VEC_WIDTH){
+        for(int lane = 0; lane < VEC_WIDTH; lane++){
+            x0[lane] = LANE_COORD(settings.origin.re, re[i + lane]);
+        }
+        group.first_point = first_point + i;
+        interior += ESCAPE_LANES(out + i, x0, y0, VEC_WIDTH, group);
+    }
+
+    // pad the remaining lanes with the last point in the span
+    if(i < n){
+        const size_t remainder = n - i;
+        for(size_t lane = 0; lane < VEC_WIDTH; lane++){
+            x0[lane] = LANE_COORD(settings.origin.re, re[lane < remainder ? i + lane : n - 1]);
+        }
+        group.first_point = first_point + i;
+        interior += ESCAPE_LANES(out + i, x0, y0, remainder, group);
+    }
+    return interior;
+}
+
+#endif
+
+/*
+ * Iterates a point of a multibrot set, or of a multicorn set if conjugate is set
+ * This mirrors multibrot and multicorn, adding the optional cycle check of escape_point
+ */
+static inline byte escape_power(const KREAL complex z0, const double d, const bool conjugate, const bool cycle_check, const byte max_iterations){
+    KREAL complex z = z0;
+    KREAL complex saved = z0;
+    size_t next_save = 1;
+    byte iteration = 0;
+    while(KCABS(z) <= 2 && iteration < max_iterations){
+        z = conjugate ? KCONJ(KCPOW(z, d)) + z0 : KCPOW(z, d) + z0;
+        iteration++;
+        if(cycle_check){
+            if(same_orbit_point(KCREAL(z), KCIMAG(z), KCREAL(saved), KCIMAG(saved))) return max_iterations;
+            if(iteration == next_save){
+                saved = z;
+                next_save *= 2;
+            }
+        }
+    }
+    return iteration;
+}
+
+/*
+ * Fills a span of a row with multibrot or multicorn values, the coordinates of the span are offsets from origin if OFFSET_COORDINATES is set
+ * Returns the number of points that were found by the interior check
+ */
+static inline size_t escape_power_span(byte* out, const CBASE* re, const CBASE im, const size_t n, const complex_t origin, const double d, const bool conjugate, const bool interior_check, const bool cycle_check, const byte max_iterations){
+    const KREAL y = SPAN_COORD(origin.im, im);
+    size_t interior = 0;
+    for(size_t i = 0; i < n; i++){
+        const KREAL x = SPAN_COORD(origin.re, re[i]);
+        if(interior_check && in_mandelbrot_interior(x, y)){
+            out[i] = max_iterations;
+            interior++;
+        }
+        else {
+            out[i] = escape_power(x + y * I, d, conjugate, cycle_check, max_iterations);
+        }
+    }
+    return interior;
+}
+
+/*
+ * Gets the settings of a span from the generation parameters
+ */
+static inline escape_settings get_settings(const enum escape_map map, const byte max_iterations, const grid_gen_params* params){
+    return (escape_settings){
+        .map = map,
+        .degree = map == MAP_MULTIBROT || map == MAP_MULTICORN ? params->degree : 2,
+        .exponent = map == MAP_MULTIBROT_POLAR || map == MAP_MULTICORN_POLAR ? params->degree : 2,
+        .c = map == MAP_JULIA ? params->cr.constant : (complex_t){0},
+        .R = map == MAP_JULIA ? params->cr.radius : 2,
+        .interior_check = (map == MAP_MANDELBROT || (map == MAP_MULTIBROT_POLAR && params->degree == 2)) && (params->flags & GEN_INTERIOR_CHECK),
+        .cycle_check = params->flags & GEN_CYCLE_CHECK,
+        .max_iterations = max_iterations,
+        .origin = params->origin,
+#if VEC_WIDTH > 1 && !OFFSET_COORDINATES
+        .state = params->state,
+#else
+        .state = NULL,
+#endif
+        .first_point = 0
+    };
+}
+
+/*
+ * Fills a span of a row with mandelbrot values
+ * With GEN_INTERIOR_CHECK points inside the main cardioid and period 2 bulb are assigned max_iterations directly
+ */
+static void mandelbrot_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+    add_interior_points(params, escape_span(out, re, im, n, get_settings(MAP_MANDELBROT, max_iterations, params)));
+}
+
+/*
+ * Fills a span of a row with tricorn values
+ */
+static void tricorn_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+    escape_span(out, re, im, n, get_settings(MAP_TRICORN, max_iterations, params));
+}
+
+/*
+ * Fills a span of a row with burning_ship values
+ */
+static void burning_ship_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+    escape_span(out, re, im, n, get_settings(MAP_BURNING_SHIP, max_iterations, params));
+}
+
+// the float kernels have no polar maps, their multibrot and multicorn kernels of a real degree are the double ones
+#ifndef FLOAT_KERNELS
+
+/*
+ * Fills a span of a row with multibrot values
+ * Positive degrees are iterated in polar form when the points are vectorized, otherwise cpow is used
+ * With GEN_INTERIOR_CHECK and a degree of 2, points inside the main cardioid and period 2 bulb are assigned max_iterations directly
+ */
+static void multibrot_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+    const double d = params->degree;
+#if VEC_WIDTH > 1
+    if(d > 0){
+        add_interior_points(params, escape_span(out, re, im, n, get_settings(MAP_MULTIBROT_POLAR, max_iterations, params)));
+        return;
+    }
+#endif
+    const bool interior_check = (params->flags & GEN_INTERIOR_CHECK) && d == 2;
+    const bool cycle_check = params->flags & GEN_CYCLE_CHECK;
+    add_interior_points(params, escape_power_span(out, re, im, n, params->origin, d, false, interior_check, cycle_check, max_iterations));
+}
+
+/*
+ * Fills a span of a row with multicorn values
+ * Positive degrees are iterated in polar form when the points are vectorized, otherwise cpow is used
+ */
+static void multicorn_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+#if VEC_WIDTH > 1
+    if(params->degree > 0){
+        escape_span(out, re, im, n, get_settings(MAP_MULTICORN_POLAR, max_iterations, params));
+        return;
+    }
+#endif
+    const bool cycle_check = params->flags & GEN_CYCLE_CHECK;
+    escape_power_span(out, re, im, n, params->origin, params->degree, true, false, cycle_check, max_iterations);
+}
+
+#endif
+
+/*
+ * Kernels for multibrot and multicorn sets of a fixed integer degree, z^degree is computed by multiplication instead of cpow
+ */
+#define INTEGER_DEGREE_ROWS(DEGREE) \
+    static void multibrot_row_##DEGREE(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){ \
+        escape_settings settings = get_settings(MAP_MULTIBROT, max_iterations, params); \
+        settings.degree = DEGREE; \
+        escape_span(out, re, im, n, settings); \
+    } \
+    static void multicorn_row_##DEGREE(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){ \
+        escape_settings settings = get_settings(MAP_MULTICORN, max_iterations, params); \
+        settings.degree = DEGREE; \
+        escape_span(out, re, im, n, settings); \
+    }
+
+INTEGER_DEGREE_ROWS(3)
+INTEGER_DEGREE_ROWS(4)
+INTEGER_DEGREE_ROWS(5)
+INTEGER_DEGREE_ROWS(6)
+INTEGER_DEGREE_ROWS(7)
+INTEGER_DEGREE_ROWS(8)
+INTEGER_DEGREE_ROWS(9)
+INTEGER_DEGREE_ROWS(10)
+INTEGER_DEGREE_ROWS(11)
+INTEGER_DEGREE_ROWS(12)
+INTEGER_DEGREE_ROWS(13)
+INTEGER_DEGREE_ROWS(14)
+INTEGER_DEGREE_ROWS(15)
+INTEGER_DEGREE_ROWS(16)
+
+/*
+ * Fills a span of a row with julia values for the constant and radius in params
+ */
+static void julia_row(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params){
+    escape_span(out, re, im, n, get_settings(MAP_JULIA, max_iterations, params));
+}
+
+const simd_kernels_t KERNEL_TABLE = {
+    .isa = STRINGIFY(KERNEL_ISA),
+    .vector_width = VEC_WIDTH,
+    .precision = KERNEL_PRECISION,
+    .precision_bits = KERNEL_PRECISION_BITS,
+    .offset_coordinates = OFFSET_COORDINATES,
+    .mandelbrot_row = mandelbrot_row,
+    .tricorn_row = tricorn_row,
+    .burning_ship_row = burning_ship_row,
+#ifndef FLOAT_KERNELS
+    .multibrot_row = multibrot_row,
+    .multicorn_row = multicorn_row,
+#endif
+    .julia_row = julia_row,
+    // degree 2 is the mandelbrot and tricorn map
+    .multibrot_integer_rows = {
+        NULL, NULL, mandelbrot_row, multibrot_row_3, multibrot_row_4, multibrot_row_5, multibrot_row_6, multibrot_row_7, multibrot_row_8,
+        multibrot_row_9, multibrot_row_10, multibrot_row_11, multibrot_row_12, multibrot_row_13, multibrot_row_14, multibrot_row_15, multibrot_row_16
+    },
+    .multicorn_integer_rows = {
+        NULL, NULL, tricorn_row, multicorn_row_3, multicorn_row_4, multicorn_row_5, multicorn_row_6, multicorn_row_7, multicorn_row_8,
+        multicorn_row_9, multicorn_row_10, multicorn_row_11, multicorn_row_12, multicorn_row_13, multicorn_row_14, multicorn_row_15, multicorn_row_16
+    }
+};
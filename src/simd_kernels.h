@@ -0,0 +1,60 @@
+/*
+ * Escape time kernels that evaluate a contiguous span of a grid row at a time
+ *
+ * The spans are evaluated several points at a time in lockstep, with the real and imaginary parts of
+ * the points held in separate vector registers. The results are identical to the scalar versions
+ * (mandelbrot, tricorn, burning_ship, julia). Multibrot and multicorn of a small integer degree have their own vectorized kernels,
+ * other degrees use cpow so their spans are evaluated a point at a time
+ *
+ * simd_kernels.c is compiled once per instruction set, each build exporting its own table of kernels.
+ * The table for the running cpu is chosen at startup, see cpu_dispatch.h
+ *
+ * It is also compiled into float tables and a long double table, which GEN_AUTO_PRECISION picks from per grid.
+ * Kernels a table does not have are NULL
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "grids.h"
+#include "precision.h"
+#include "traversal.h"
+
+// the largest degree with a specialized multibrot and multicorn kernel
+#define MAX_SPECIALIZED_DEGREE 16
+
+// integer degrees up to this limit use the specialized kernels instead of cpow, can be lowered to fall back to cpow sooner
+#ifndef INTEGER_DEGREE_LIMIT
+#define INTEGER_DEGREE_LIMIT 8
+#endif
+
+#if INTEGER_DEGREE_LIMIT > MAX_SPECIALIZED_DEGREE
+#error INTEGER_DEGREE_LIMIT can not be larger than MAX_SPECIALIZED_DEGREE
+#endif
+
+typedef struct {
+    const char* isa;
+    int vector_width;
+    // the arithmetic the points are iterated in and the bits of its mantissa
+    const char* precision;
+    int precision_bits;
+    // the kernels take the coordinates of a span as offsets from params->origin, see create_grid_coords
+    bool offset_coordinates;
+    span_kernel mandelbrot_row;
+    span_kernel tricorn_row;
+    span_kernel burning_ship_row;
+    span_kernel multibrot_row;
+    span_kernel multicorn_row;
+    span_kernel julia_row;
+    // kernels indexed by their integer degree, starting at 2
+    span_kernel multibrot_integer_rows[MAX_SPECIALIZED_DEGREE + 1];
+    span_kernel multicorn_integer_rows[MAX_SPECIALIZED_DEGREE + 1];
+} simd_kernels_t;
+
+extern const simd_kernels_t simd_kernels_sse2;
+extern const simd_kernels_t simd_kernels_avx2;
+extern const simd_kernels_t simd_kernels_avx512;
+extern const simd_kernels_t float_kernels_sse2;
+extern const simd_kernels_t float_kernels_avx2;
+extern const simd_kernels_t float_kernels_avx512;
+extern const simd_kernels_t extended_kernels;
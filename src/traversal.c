@@ -0,0 +1,327 @@
+/*
+ * Functions for walking a grid tile by tile
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "traversal.h"
+
+/*
+ * Computes the coordinates of every column and row of a grid
+ * If offsets is set the coordinates are offsets from the lower left corner, which the kernels add in a wider precision.
+ * They always are with DOUBLE_DOUBLE_PRECISION, where the kernels add them in double-double
+ *
+ * Returns NULL if the coordinates could not be allocated
+ */
+grid_coords_t* create_grid_coords(const grid_t* grid, const bool offsets){
+    const size_t x_res = grid->x;
+    const size_t y_res = grid->y;
+#ifdef DOUBLE_DOUBLE_PRECISION
+    (void)offsets;
+    const CBASE x_min = 0;
+    const CBASE y_min = 0;
+    const CBASE x_step = dd_sub(dd_real(grid->upper_right), dd_real(grid->lower_left)).hi / (double)x_res;
+    const CBASE y_step = dd_sub(dd_imag(grid->upper_right), dd_imag(grid->lower_left)).hi / (double)y_res;
+#else
+    const CBASE x_min = offsets ? 0 : grid->lower_left.re;
+    const CBASE y_min = offsets ? 0 : grid->lower_left.im;
+
+    const CBASE x_step = (grid->upper_right.re - grid->lower_left.re) / (double)x_res;
+    const CBASE y_step = (grid->upper_right.im - grid->lower_left.im) / (double)y_res;
+#endif
+
+    CBASE* re = malloc(x_res * sizeof(CBASE));
+    CBASE* im = malloc(y_res * sizeof(CBASE));
+    grid_coords_t* coords = malloc(sizeof(grid_coords_t));
+    if(!re || !im || !coords){
+        fprintf(stderr, "Error allocating coordinates for a %zux%zu grid\n", x_res, y_res);
+        free(re); free(im); free(coords);
+        return NULL;
+    }
+
+    for(size_t x_index = 0; x_index < x_res; x_index++){
+        re[x_index] = x_min + x_index * x_step;
+    }
+    for(size_t y_index = 0; y_index < y_res; y_index++){
+        im[y_index] = y_min + y_index * y_step;
+    }
+
+    *coords = (grid_coords_t){
+        .x = x_res,
+        .y = y_res,
+        .re = re,
+        .im = im,
+        .mirror_rows = NULL,
+        .mirror_columns = NULL
+    };
+
+    return coords;
+}
+
+/*
+ * Frees a set of coordinates and its members
+ */
+void free_grid_coords(grid_coords_t* coords){
+    if(!coords) return;
+
+    free(coords->re);
+    free(coords->im);
+    free(coords->mirror_rows);
+    free(coords->mirror_columns);
+    free(coords);
+}
+
+/*
+ * Pairs up the coordinates of an ascending axis that are exact negatives of each other
+ * mirrors[i] is set to the index of the negative of coordinate i, or NO_MIRROR if the axis does not hold it
+ * Returns the number of pairs found, a coordinate of 0 is paired with itself
+ */
+static size_t pair_negatives(const CBASE* axis, const size_t n, size_t* mirrors){
+    for(size_t i = 0; i < n; i++){
+        mirrors[i] = NO_MIRROR;
+    }
+
+    size_t pairs = 0;
+    size_t low = 0;
+    size_t high = n;
+    while(low < high){
+        if(axis[low] == -axis[high - 1]){
+            mirrors[low] = high - 1;
+            mirrors[high - 1] = low;
+            pairs++;
+            low++;
+            high--;
+        }
+        else if(-axis[low] > axis[high - 1]){
+            low++;
+        }
+        else {
+            high--;
+        }
+    }
+    return pairs;
+}
+
+/*
+ * Finds the rows of a grid that can be copied from the rows their coordinates mirror under a symmetry
+ * Of every pair of rows whose imaginary coordinates are exact negatives of each other the upper one is copied,
+ * with ORIGIN_SYMMETRY its points are taken from the columns whose real coordinates are the exact negatives of theirs.
+ * Only exact negatives are paired so copied rows are bit identical to iterated ones, coordinates that are offsets
+ * from the lower left corner of a grid can not be mirrored this way
+ *
+ * Returns the number of rows that are copied, or 0 if there are none or the mirrors could not be allocated
+ */
+size_t mirror_grid_coords(grid_coords_t* coords, const enum grid_symmetry symmetry){
+    if(symmetry == NO_SYMMETRY) return 0;
+
+    size_t* rows = malloc(coords->y * sizeof(size_t));
+    size_t* columns = symmetry == ORIGIN_SYMMETRY ? malloc(coords->x * sizeof(size_t)) : NULL;
+    if(!rows || (symmetry == ORIGIN_SYMMETRY && !columns)){
+        fprintf(stderr, "Error allocating the mirrors of a %zux%zu grid\n", coords->x, coords->y);
+        free(rows); free(columns);
+        return 0;
+    }
+
+    const size_t pairs = pair_negatives(coords->im, coords->y, rows);
+    // the lower row of a pair is iterated, a row on the real axis is paired with itself and iterated too
+    size_t copied = 0;
+    for(size_t row = 0; row < coords->y; row++){
+        if(rows[row] >= row){
+            rows[row] = NO_MIRROR;
+        }
+        else {
+            copied++;
+        }
+    }
+    if(!pairs || !copied){
+        free(rows); free(columns);
+        return 0;
+    }
+
+    if(columns && !pair_negatives(coords->re, coords->x, columns)){
+        free(rows); free(columns);
+        return 0;
+    }
+
+    free(coords->mirror_rows);
+    free(coords->mirror_columns);
+    coords->mirror_rows = rows;
+    coords->mirror_columns = columns;
+    return copied;
+}
+
+/*
+ * Fills a row of a grid that mirror_grid_coords chose to copy from the row it mirrors, which has to be filled already
+ * Points whose column has no mirror are iterated, rows that are not copied are left as they are
+ */
+void fill_mirrored_row(grid_t* grid, const grid_coords_t* coords, const size_t row, span_kernel kernel, const grid_gen_params* params){
+    if(!coords->mirror_rows || coords->mirror_rows[row] == NO_MIRROR) return;
+
+    const size_t x_res = grid->x;
+    byte* out = grid->data + row * x_res;
+    const byte* source = grid->data + coords->mirror_rows[row] * x_res;
+    const size_t* columns = coords->mirror_columns;
+    if(!columns){
+        memcpy(out, source, x_res);
+        return;
+    }
+
+    size_t x = 0;
+    while(x < x_res){
+        // iterate a run of columns without a mirror as one span
+        size_t end = x;
+        while(end < x_res && columns[end] == NO_MIRROR){
+            end++;
+        }
+        if(end > x){
+            kernel(out + x, coords->re + x, coords->im[row], end - x, grid->max_iterations, params);
+            x = end;
+            continue;
+        }
+        out[x] = source[columns[x]];
+        x++;
+    }
+}
+
+/*
+ * Gets the number of tiles needed to cover a grid
+ */
+size_t tile_count(const grid_t* grid){
+    const size_t tiles_x = (grid->x + TILE_WIDTH - 1) / TILE_WIDTH;
+    const size_t tiles_y = (grid->y + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    return tiles_x * tiles_y;
+}
+
+/*
+ * Gets a tile of a grid, tiles are numbered in row major order
+ * Tiles on the right and bottom edges of the grid are clipped to fit
+ */
+tile_t get_tile(const grid_t* grid, const size_t index){
+    const size_t tiles_x = (grid->x + TILE_WIDTH - 1) / TILE_WIDTH;
+    const size_t x = (index % tiles_x) * TILE_WIDTH;
+    const size_t y = (index / tiles_x) * TILE_HEIGHT;
+
+    return (tile_t){
+        .x = x,
+        .y = y,
+        .width = grid->x - x < TILE_WIDTH ? grid->x - x : TILE_WIDTH,
+        .height = grid->y - y < TILE_HEIGHT ? grid->y - y : TILE_HEIGHT
+    };
+}
+
+/*
+ * Fills a tile of a grid by handing each of its row spans to a kernel, skipping the rows that are copied from their mirrors
+ */
+void fill_tile(grid_t* grid, const grid_coords_t* coords, const tile_t tile, span_kernel kernel, const grid_gen_params* params){
+    const size_t x_res = grid->x;
+    const byte max_iterations = grid->max_iterations;
+    byte* data = grid->data;
+
+    const size_t* mirrors = coords->mirror_rows;
+
+    for(size_t row = tile.y; row < tile.y + tile.height; row++){
+        // rows copied from their mirror are filled afterwards by fill_mirrored_row
+        if(mirrors && mirrors[row] != NO_MIRROR) continue;
+        kernel(data + row * x_res + tile.x, coords->re + tile.x, coords->im[row], tile.width, max_iterations, params);
+    }
+}
+
+/*
+ * Fills the points of a column of a grid between rows y_start and y_end (exclusive)
+ */
+static void fill_column(grid_t* grid, const grid_coords_t* coords, const size_t x, const size_t y_start, const size_t y_end, span_kernel kernel, const grid_gen_params* params){
+    const size_t x_res = grid->x;
+    const byte max_iterations = grid->max_iterations;
+    byte* data = grid->data;
+
+    for(size_t row = y_start; row < y_end; row++){
+        kernel(data + row * x_res + x, coords->re + x, coords->im[row], 1, max_iterations, params);
+    }
+}
+
+/*
+ * Fills the outermost points of a rectangle
+ */
+void fill_border(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params){
+    const size_t x_res = grid->x;
+    const byte max_iterations = grid->max_iterations;
+    const size_t last_row = rect.y + rect.height - 1;
+    byte* data = grid->data;
+
+    kernel(data + rect.y * x_res + rect.x, coords->re + rect.x, coords->im[rect.y], rect.width, max_iterations, params);
+    if(rect.height > 1){
+        kernel(data + last_row * x_res + rect.x, coords->re + rect.x, coords->im[last_row], rect.width, max_iterations, params);
+    }
+    fill_column(grid, coords, rect.x, rect.y + 1, last_row, kernel, params);
+    if(rect.width > 1){
+        fill_column(grid, coords, rect.x + rect.width - 1, rect.y + 1, last_row, kernel, params);
+    }
+}
+
+/*
+ * Checks if every point on the border of a rectangle has the same value, storing it in value
+ */
+static bool uniform_border(const grid_t* grid, const tile_t rect, byte* value){
+    const size_t x_res = grid->x;
+    const byte* top = grid->data + rect.y * x_res + rect.x;
+    const byte* bottom = top + (rect.height - 1) * x_res;
+    const byte first = top[0];
+
+    for(size_t i = 0; i < rect.width; i++){
+        if(top[i] != first || bottom[i] != first) return false;
+    }
+    for(size_t i = 1; i < rect.height - 1; i++){
+        if(top[i * x_res] != first || top[i * x_res + rect.width - 1] != first) return false;
+    }
+
+    *value = first;
+    return true;
+}
+
+/*
+ * Performs one step of Mariani-Silver subdivision on a rectangle whose border has already been filled
+ *
+ * If the border has a single value the interior is filled with it, small rectangles have their interior computed,
+ * otherwise the rectangle is split in half along its longer side and the line between the halves is computed
+ *
+ * Returns the number of halves written to children which still need to be subdivided
+ */
+size_t subdivide_rect(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params, tile_t children[2]){
+    if(rect.width <= 2 || rect.height <= 2) return 0;
+
+    const size_t x_res = grid->x;
+    const tile_t interior = {
+        .x = rect.x + 1,
+        .y = rect.y + 1,
+        .width = rect.width - 2,
+        .height = rect.height - 2
+    };
+
+    byte value;
+    if(uniform_border(grid, rect, &value)){
+        for(size_t row = interior.y; row < interior.y + interior.height; row++){
+            memset(grid->data + row * x_res + interior.x, value, interior.width);
+        }
+        return 0;
+    }
+
+    if(rect.width <= SUBDIVIDE_MIN_SIZE || rect.height <= SUBDIVIDE_MIN_SIZE){
+        fill_tile(grid, coords, interior, kernel, params);
+        return 0;
+    }
+
+    if(rect.width >= rect.height){
+        const size_t split = rect.width / 2;
+        fill_column(grid, coords, rect.x + split, interior.y, interior.y + interior.height, kernel, params);
+        children[0] = (tile_t){ .x = rect.x, .y = rect.y, .width = split + 1, .height = rect.height };
+        children[1] = (tile_t){ .x = rect.x + split, .y = rect.y, .width = rect.width - split, .height = rect.height };
+    }
+    else {
+        const size_t split = rect.height / 2;
+        const size_t row = rect.y + split;
+        kernel(grid->data + row * x_res + interior.x, coords->re + interior.x, coords->im[row], interior.width, grid->max_iterations, params);
+        children[0] = (tile_t){ .x = rect.x, .y = rect.y, .width = rect.width, .height = split + 1 };
+        children[1] = (tile_t){ .x = rect.x, .y = row, .width = rect.width, .height = rect.height - split };
+    }
+    return 2;
+}
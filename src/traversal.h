@@ -0,0 +1,78 @@
+/*
+ * Traversal of a grid in cache sized tiles
+ *
+ * Instead of converting every grid point into a complex number, the coordinates of each column and row
+ * are computed once and kernels are handed contiguous spans of a row to fill
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "grids.h"
+#include "fractals.h"
+#include "precision.h"
+
+// dimensions of a tile in grid points, the width should be a multiple of the widest vector
+#ifndef TILE_WIDTH
+#define TILE_WIDTH 256
+#endif
+
+#ifndef TILE_HEIGHT
+#define TILE_HEIGHT 16
+#endif
+
+// rectangles with a side of at most this many points are filled directly instead of being subdivided
+#ifndef SUBDIVIDE_MIN_SIZE
+#define SUBDIVIDE_MIN_SIZE 8
+#endif
+
+// marks a row or column without a mirror, see mirror_grid_coords
+#define NO_MIRROR SIZE_MAX
+
+// the symmetry of a fractal, which lets the rows that mirror other rows of a grid be copied instead of iterated
+enum grid_symmetry {
+    NO_SYMMETRY,
+    // the fractal of conj(c) is the conjugate of the fractal of c, like the mandelbrot set
+    REAL_AXIS_SYMMETRY,
+    // the fractal of -z is the fractal of z, like julia sets
+    ORIGIN_SYMMETRY
+};
+
+// the coordinates of every column and row of a grid
+typedef struct {
+    size_t x;
+    size_t y;
+    CBASE* re;
+    CBASE* im;
+    // the row each row is copied from, or NO_MIRROR if it is iterated, NULL if no row is copied
+    size_t* mirror_rows;
+    // the column each column of a copied row is taken from, or NO_MIRROR if it is iterated, NULL if every column is copied in place
+    size_t* mirror_columns;
+} grid_coords_t;
+
+// a rectangular region of a grid, x and y are the column and row of its upper left point
+typedef struct {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} tile_t;
+
+/*
+ * Fills n points of a row with escape values
+ * re holds the real component of each point in the span, im is the imaginary component shared by the row
+ */
+typedef void (*span_kernel)(byte* out, const CBASE* re, const CBASE im, const size_t n, const byte max_iterations, const grid_gen_params* params);
+
+grid_coords_t* create_grid_coords(const grid_t* grid, const bool offsets);
+void free_grid_coords(grid_coords_t* coords);
+size_t mirror_grid_coords(grid_coords_t* coords, const enum grid_symmetry symmetry);
+void fill_mirrored_row(grid_t* grid, const grid_coords_t* coords, const size_t row, span_kernel kernel, const grid_gen_params* params);
+
+size_t tile_count(const grid_t* grid);
+tile_t get_tile(const grid_t* grid, const size_t index);
+void fill_tile(grid_t* grid, const grid_coords_t* coords, const tile_t tile, span_kernel kernel, const grid_gen_params* params);
+
+void fill_border(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params);
+size_t subdivide_rect(grid_t* grid, const grid_coords_t* coords, const tile_t rect, span_kernel kernel, const grid_gen_params* params, tile_t children[2]);
@@ -0,0 +1,135 @@
+/*
+ * Work stealing scheduler, see work_stealing.h
+ *
+ * A deque holds a contiguous range of task indices, the owner pops from the front and thieves split off the back,
+ * which keeps each thread working on tasks that lie next to each other in the grid
+ */
+#include <omp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "work_stealing.h"
+
+// deques are padded to a cache line so the owners do not invalidate each other's lines
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+    omp_lock_t lock;
+    size_t begin;
+    size_t end;
+} __attribute__((aligned(CACHE_LINE_SIZE))) task_deque;
+
+// the deques of the team, kept between calls
+static task_deque* deques = NULL;
+static int deque_count = 0;
+
+/*
+ * Makes sure there is a deque for every thread of a team
+ * Returns false if they could not be allocated
+ */
+static bool reserve_deques(const int threads){
+    if(threads <= deque_count) return true;
+
+    task_deque* grown = aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(task_deque));
+    if(!grown){
+        fprintf(stderr, "Error allocating the work stealing deques of %d threads\n", threads);
+        return false;
+    }
+    for(int i = 0; i < deque_count; i++){
+        omp_destroy_lock(&deques[i].lock);
+    }
+    free(deques);
+    for(int i = 0; i < threads; i++){
+        omp_init_lock(&grown[i].lock);
+    }
+    deques = grown;
+    deque_count = threads;
+    return true;
+}
+
+/*
+ * Takes the task at the front of a deque
+ * Returns false if the deque is empty
+ */
+static bool pop_task(task_deque* deque, size_t* index){
+    omp_set_lock(&deque->lock);
+    const bool found = deque->begin < deque->end;
+    if(found){
+        *index = deque->begin++;
+    }
+    omp_unset_lock(&deque->lock);
+    return found;
+}
+
+/*
+ * Moves the back half of the tasks of the first other thread that has any into the deque of thread id
+ * Returns false if every other deque is empty, tasks that are being moved by another thief are left to that thief
+ */
+static bool steal_half(const int id, const int threads){
+    for(int offset = 1; offset < threads; offset++){
+        task_deque* victim = &deques[(id + offset) % threads];
+
+        omp_set_lock(&victim->lock);
+        const size_t remaining = victim->end - victim->begin;
+        const size_t stolen = (remaining + 1) / 2;
+        victim->end -= stolen;
+        const size_t split = victim->end;
+        omp_unset_lock(&victim->lock);
+
+        if(stolen){
+            task_deque* own = &deques[id];
+            omp_set_lock(&own->lock);
+            own->begin = split;
+            own->end = split + stolen;
+            omp_unset_lock(&own->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Runs task for every index in [0, count) on the threads of a new OpenMP team
+ * If the deques can not be allocated the tasks are handed out by a dynamic schedule instead
+ *
+ * Returns the number of times a thread stole tasks
+ */
+size_t steal_tasks(const size_t count, stolen_task task, void* context){
+    const int threads = omp_get_max_threads();
+    if(!reserve_deques(threads)){
+        #pragma omp parallel for default(none) shared(count, task, context) schedule(dynamic)
+        for(size_t i = 0; i < count; i++){
+            task(i, context);
+        }
+        return 0;
+    }
+
+    size_t steals = 0;
+    #pragma omp parallel default(none) shared(count, task, context, deques) reduction(+:steals) num_threads(threads)
+    {
+        const int id = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+        task_deque* own = &deques[id];
+        omp_set_lock(&own->lock);
+        own->begin = count * id / team;
+        own->end = count * (id + 1) / team;
+        omp_unset_lock(&own->lock);
+
+        // no thread may steal before every deque holds its share
+        #pragma omp barrier
+
+        size_t index;
+        while(true){
+            if(pop_task(own, &index)){
+                task(index, context);
+            }
+            else if(steal_half(id, team)){
+                steals++;
+            }
+            else {
+                break;
+            }
+        }
+    }
+    return steals;
+}
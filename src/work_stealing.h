@@ -0,0 +1,18 @@
+/*
+ * Work stealing scheduler for the tiles and rows of a grid
+ *
+ * Every thread of the OpenMP team owns a deque of task indices, starting with a contiguous share of the tasks so that
+ * neighbouring tiles are filled by the same thread. A thread takes tasks from the front of its own deque and,
+ * once it runs dry, steals the back half of the remaining tasks of another thread.
+ *
+ * The deques are kept between calls and only grow when a larger team asks for them, so repeated renders
+ * (like the NUM_RUNS loop of time_fractal) reuse them along with the threads OpenMP keeps alive between parallel regions
+ */
+#pragma once
+
+#include <stddef.h>
+
+// a task of a scheduled loop, index is in [0, count)
+typedef void (*stolen_task)(const size_t index, void* context);
+
+size_t steal_tasks(const size_t count, stolen_task task, void* context);